@@ -0,0 +1,120 @@
+#include"Attacks.h"
+
+
+Magic bishop_magics[64];
+Magic castle_magics[64];
+
+/* Attack sets for every blocker arrangement, shared by all squares */
+static Bitboard bishop_table[0x1480];
+static Bitboard castle_table[0x19000];
+
+static const int bishop_directions[4][2] = {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+static const int castle_directions[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+
+#if !defined(__BMI2__)
+static const Bitboard magic_seeds[8] = {728, 10316, 55013, 32803, 12281, 15100, 16645, 255};
+#endif
+
+
+/* -------------------- Helpers -------------------- */
+/* Return the squares reached from square along directions, stopping at the first occupied square */
+static Bitboard sliding_attacks(int square, Bitboard occupied, const int directions[4][2]) {
+  Bitboard attacks = 0;
+
+  for (int d = 0; d < 4; d++) {
+    Bitboard b = step_bb(square, directions[d][0], directions[d][1]);
+
+    while (b) {
+      attacks |= b;
+      if (occupied & b)
+        break;
+      b = step_bb(lsb(b), directions[d][0], directions[d][1]);
+    }
+  }
+  return attacks;
+}
+
+/* Return the edge squares that never affect a slider on square */
+static Bitboard edges(int square) {
+  const Bitboard rank_edges = 0xFF000000000000FFULL;
+  const Bitboard file_edges = 0x8181818181818181ULL;
+  Bitboard own_rank = 0xFFULL << (8 * square_rank(square));
+  Bitboard own_file = 0x0101010101010101ULL << square_file(square);
+
+  return (rank_edges & ~own_rank) | (file_edges & ~own_file);
+}
+
+/* Return a random number with few bits set, a good magic candidate */
+static Bitboard sparse_random(Bitboard &seed) {
+  Bitboard r = ~0ULL;
+
+  for (int i = 0; i < 3; i++) {
+    seed ^= seed >> 12;
+    seed ^= seed << 25;
+    seed ^= seed >> 27;
+    r &= seed * 2685821657736338717ULL;
+  }
+  return r;
+}
+
+/* Fill magics and table for a slider moving along directions */
+static void init_magics(Magic magics[64], Bitboard table[], const int directions[4][2]) {
+  Bitboard occupancy[4096];
+  Bitboard reference[4096];
+  int epoch[4096] = {0};
+  int attempt = 0;
+  Bitboard* next = table;
+
+  for (int square = 0; square < 64; square++) {
+    Magic &m = magics[square];
+    int size = 0;
+
+    m.mask = sliding_attacks(square, 0, directions) & ~edges(square);
+    m.shift = 64 - pop_count(m.mask);
+    m.attacks = next;
+
+    // enumerate every subset of the mask (Carry-Rippler) with its attack set
+    Bitboard b = 0;
+    do {
+      occupancy[size] = b;
+      reference[size] = sliding_attacks(square, b, directions);
+#if defined(__BMI2__)
+      m.attacks[m.index(b)] = reference[size];
+#endif
+      size++;
+      b = (b - m.mask) & m.mask;
+    } while (b);
+
+    next += size;
+
+#if !defined(__BMI2__)
+    // search for a magic that maps every subset without a harmful collision,
+    // seeded per rank with values known to converge quickly
+    Bitboard seed = magic_seeds[square_rank(square)];
+    for (int i = 0; i < size; ) {
+      do {
+        m.magic = sparse_random(seed);
+      } while (pop_count((m.magic * m.mask) >> 56) < 6);
+
+      for (attempt++, i = 0; i < size; i++) {
+        unsigned index = m.index(occupancy[i]);
+
+        if (epoch[index] < attempt) {
+          epoch[index] = attempt;
+          m.attacks[index] = reference[i];
+        }
+        else if (m.attacks[index] != reference[i])
+          break;
+      }
+    }
+#endif
+  }
+}
+
+/* Fills the slider tables during static initialisation */
+static struct SliderTables {
+  SliderTables() {
+    init_magics(bishop_magics, bishop_table, bishop_directions);
+    init_magics(castle_magics, castle_table, castle_directions);
+  }
+} slider_tables;
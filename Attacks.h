@@ -0,0 +1,181 @@
+#ifndef ATTACKS_H
+#define ATTACKS_H
+
+#include<array>
+
+#if defined(__BMI2__)
+#include<immintrin.h>
+#endif
+
+#include"Bitboard.h"
+
+/* Tables of the squares each piece type can reach from each square.
+   Colour indices are 0 for White and 1 for Black. */
+
+typedef std::array<Bitboard, 64> SquareTable;
+
+/* -------------------- Table construction -------------------- */
+/* Return the square rank_step and file_step away from square, or an empty set if off the board */
+constexpr Bitboard step_bb(int square, int rank_step, int file_step) {
+  int rank = square_rank(square) + rank_step;
+  int file = square_file(square) + file_step;
+
+  if ((rank < 0) || (rank > 7) || (file < 0) || (file > 7))
+    return 0;
+  return square_bb(make_square(rank, file));
+}
+
+constexpr SquareTable make_knight_attacks() {
+  SquareTable table{};
+
+  for (int square = 0; square < 64; square++)
+    table[square] = step_bb(square, 2, 1) | step_bb(square, 2, -1) | step_bb(square, -2, 1) | step_bb(square, -2, -1)
+                  | step_bb(square, 1, 2) | step_bb(square, 1, -2) | step_bb(square, -1, 2) | step_bb(square, -1, -2);
+  return table;
+}
+
+constexpr SquareTable make_king_attacks() {
+  SquareTable table{};
+
+  for (int square = 0; square < 64; square++)
+    table[square] = step_bb(square, 1, -1) | step_bb(square, 1, 0) | step_bb(square, 1, 1) | step_bb(square, 0, -1)
+                  | step_bb(square, 0, 1) | step_bb(square, -1, -1) | step_bb(square, -1, 0) | step_bb(square, -1, 1);
+  return table;
+}
+
+constexpr SquareTable make_pawn_attacks(int colour) {
+  SquareTable table{};
+  int forward = (colour == 0) ? 1 : -1;
+
+  for (int square = 0; square < 64; square++)
+    table[square] = step_bb(square, forward, -1) | step_bb(square, forward, 1);
+  return table;
+}
+
+constexpr SquareTable make_pawn_pushes(int colour) {
+  SquareTable table{};
+  int forward = (colour == 0) ? 1 : -1;
+  int start_rank = (colour == 0) ? 1 : 6;
+
+  for (int square = 0; square < 64; square++) {
+    table[square] = step_bb(square, forward, 0);
+    if (square_rank(square) == start_rank)
+      table[square] |= step_bb(square, 2 * forward, 0);
+  }
+  return table;
+}
+
+/* -------------------- Leaper tables -------------------- */
+/* Built at compile time */
+inline constexpr SquareTable knight_attacks = make_knight_attacks();
+
+inline constexpr SquareTable king_attacks = make_king_attacks();
+
+/* Squares a pawn of colour attacks diagonally */
+inline constexpr SquareTable pawn_attacks[2] = {make_pawn_attacks(0), make_pawn_attacks(1)};
+
+/* Squares a pawn of colour can advance to, including the double step from its starting rank */
+inline constexpr SquareTable pawn_pushes[2] = {make_pawn_pushes(0), make_pawn_pushes(1)};
+
+/* -------------------- Ray tables -------------------- */
+typedef std::array<SquareTable, 64> SquarePairTable;
+
+static constexpr int ray_directions[8][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+
+constexpr SquarePairTable make_between() {
+  SquarePairTable table{};
+
+  for (int from = 0; from < 64; from++) {
+    for (int d = 0; d < 8; d++) {
+      Bitboard path = 0;
+      Bitboard b = step_bb(from, ray_directions[d][0], ray_directions[d][1]);
+
+      while (b) {
+        table[from][lsb(b)] = path;
+        path |= b;
+        b = step_bb(lsb(b), ray_directions[d][0], ray_directions[d][1]);
+      }
+    }
+  }
+  return table;
+}
+
+/* Return the squares from square to the edge of the board in one direction */
+constexpr Bitboard ray_bb(int square, int rank_step, int file_step) {
+  Bitboard ray = 0;
+  Bitboard b = step_bb(square, rank_step, file_step);
+
+  while (b) {
+    ray |= b;
+    b = step_bb(lsb(b), rank_step, file_step);
+  }
+  return ray;
+}
+
+constexpr SquarePairTable make_line() {
+  SquarePairTable table{};
+
+  for (int from = 0; from < 64; from++) {
+    for (int d = 0; d < 8; d++) {
+      Bitboard ray = ray_bb(from, ray_directions[d][0], ray_directions[d][1]);
+      Bitboard full_line = ray | ray_bb(from, -ray_directions[d][0], -ray_directions[d][1]) | square_bb(from);
+
+      for (Bitboard b = ray; b; b &= b - 1)
+        table[from][lsb(b)] = full_line;
+    }
+  }
+  return table;
+}
+
+/* Squares strictly between two squares on a shared rank, file or diagonal, otherwise empty */
+inline constexpr SquarePairTable between = make_between();
+
+/* The whole rank, file or diagonal through two squares, otherwise empty */
+inline constexpr SquarePairTable line = make_line();
+
+/* Return true if the three squares lie on one rank, file or diagonal */
+constexpr bool aligned(int a, int b, int c) {
+  return (line[a][b] & square_bb(c)) != 0;
+}
+
+/* -------------------- Sliding attacks -------------------- */
+/* Attack lookup for a slider on one square. The relevant blockers (mask) are
+   hashed to a table index with PEXT where the CPU has it, otherwise with a
+   magic multiply. Tables are filled in Attacks.cpp before main runs. */
+struct Magic {
+  Bitboard mask;
+  Bitboard magic;
+  Bitboard* attacks;
+  unsigned shift;
+
+  /* Return the table index for the blockers in occupied */
+  unsigned index(Bitboard occupied) const {
+#if defined(__BMI2__)
+    return static_cast<unsigned>(_pext_u64(occupied, mask));
+#else
+    return static_cast<unsigned>(((occupied & mask) * magic) >> shift);
+#endif
+  }
+};
+
+extern Magic bishop_magics[64];
+extern Magic castle_magics[64];
+
+/* Return the squares a bishop on square attacks given the occupied squares */
+inline Bitboard bishop_attacks(int square, Bitboard occupied) {
+  const Magic &m = bishop_magics[square];
+  return m.attacks[m.index(occupied)];
+}
+
+/* Return the squares a castle on square attacks given the occupied squares */
+inline Bitboard castle_attacks(int square, Bitboard occupied) {
+  const Magic &m = castle_magics[square];
+  return m.attacks[m.index(occupied)];
+}
+
+/* Return the squares a queen on square attacks given the occupied squares */
+inline Bitboard queen_attacks(int square, Bitboard occupied) {
+  return bishop_attacks(square, occupied) | castle_attacks(square, occupied);
+}
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include<cstdint>
+
+/* A set of squares, one bit per square. Square 0 is A1, square 63 is H8. */
+typedef uint64_t Bitboard;
+
+/* -------------------- Squares -------------------- */
+/* Return the square at rank (0 = rank 1) and file (0 = file A) */
+constexpr int make_square(int rank, int file) {
+  return (rank << 3) | file;
+}
+
+/* Return the rank of a square (0 = rank 1) */
+constexpr int square_rank(int square) {
+  return square >> 3;
+}
+
+/* Return the file of a square (0 = file A) */
+constexpr int square_file(int square) {
+  return square & 7;
+}
+
+/* -------------------- Bit operations -------------------- */
+/* Return a bitboard with only square set */
+constexpr Bitboard square_bb(int square) {
+  return 1ULL << square;
+}
+
+/* Return the number of squares in the set */
+constexpr int pop_count(Bitboard b) {
+  return __builtin_popcountll(b);
+}
+
+/* Return the lowest square in a non-empty set */
+constexpr int lsb(Bitboard b) {
+  return __builtin_ctzll(b);
+}
+
+/* Remove the lowest square from a non-empty set and return it */
+inline int pop_lsb(Bitboard &b) {
+  int square = lsb(b);
+  b &= b - 1;
+  return square;
+}
+
+#endif
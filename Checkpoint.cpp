@@ -0,0 +1,51 @@
+#include<cstdio>
+#include<cstring>
+#include<fstream>
+
+using namespace std;
+
+#include"Checkpoint.h"
+
+
+/* Identifies checkpoint files, and the version of the layout they use */
+static const char checkpoint_magic[8] = {'C', 'H', 'E', 'S', 'S', 'C', 'K', 'P'};
+static const uint32_t checkpoint_version = 1;
+
+bool write_checkpoint(const string &path, const Snapshot snapshots[], size_t count) {
+  CheckpointHeader header = CheckpointHeader();
+  string temporary = path + ".tmp";
+  ofstream out(temporary, ios::binary | ios::trunc);
+
+  memcpy(header.magic, checkpoint_magic, sizeof(header.magic));
+  header.version = checkpoint_version;
+  header.count = count;
+
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(snapshots), count * sizeof(Snapshot));
+  out.close();
+
+  if (out.fail() || (rename(temporary.c_str(), path.c_str()) != 0)) {
+    remove(temporary.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool read_checkpoint(const string &path, vector<Snapshot> &snapshots) {
+  CheckpointHeader header;
+  ifstream in(path, ios::binary);
+
+  if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      (memcmp(header.magic, checkpoint_magic, sizeof(header.magic)) != 0) || (header.version != checkpoint_version))
+    return false;
+
+  // the file must hold every snapshot the header counts before any are allocated
+  in.seekg(0, ios::end);
+  uint64_t length = static_cast<uint64_t>(in.tellg()) - sizeof(header);
+  if (header.count > length / sizeof(Snapshot))
+    return false;
+
+  snapshots.resize(header.count);
+  in.seekg(sizeof(header));
+  return static_cast<bool>(in.read(reinterpret_cast<char*>(snapshots.data()), header.count * sizeof(Snapshot)));
+}
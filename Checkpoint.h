@@ -0,0 +1,30 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include<cstdint>
+#include<string>
+#include<vector>
+
+#include"Position.h"
+
+/* Checkpoint files are laid out in host byte order as a CheckpointHeader
+   followed by one Snapshot per game, in the order they were saved. */
+
+/* Start of every checkpoint file */
+struct CheckpointHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t count;
+};
+
+static_assert(sizeof(CheckpointHeader) == 24, "CheckpointHeader is part of the file format");
+
+/* Write count snapshots to a checkpoint at path. The file is written under another name and renamed over
+   path, so an earlier checkpoint there stays whole until the new one is. Return false if it cannot be written. */
+bool write_checkpoint(const std::string &path, const Snapshot snapshots[], size_t count);
+
+/* Read every snapshot of the checkpoint at path into snapshots. Return false if it cannot be read or is cut short. */
+bool read_checkpoint(const std::string &path, std::vector<Snapshot> &snapshots);
+
+#endif
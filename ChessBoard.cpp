@@ -1,172 +1,207 @@
 #include<iostream>
 #include<iomanip>
 #include<cmath>
+#include<cstring>
 
 using namespace std;
 
 #include"ChessBoard.h"
+#include"Attacks.h"
+
+
+/* Names are only looked up when a piece is printed */
+static const char* const colour_names[2] = {"White", "Black"};
+static const char* const piece_names[6] = {"Pawn", "Knight", "Bishop", "Castle", "Queen", "King"};
+static const char piece_letters[] = "PNBCQK";
+static const char colour_letters[] = "WB";
+
+/* Piece letters of standard algebraic notation, in piece type order */
+static const char san_letters[] = "PNBRQK";
+
+/* Return the colour index of a colour character */
+static int colour_index(char colour) {
+  return (colour == 'W') ? WHITE : BLACK;
+}
 
 
 /* -------------------- ChessBoard -------------------- */
 /* -------------------- Constructor -------------------- */
-ChessBoard::ChessBoard() : moves_made(0), current_turn('W') {
-  for (int rank = 0; rank < 8; rank++) {
-    for (int file = 0; file < 8; file++) {
-      chess_map[rank][file] = nullptr;
-    }
-  }
-
-  initialise_board();
+ChessBoard::ChessBoard(bool quiet) : moves_made(0), current_turn('W'), undoable_moves(0) {
+  initialise_board(quiet);
 }
 
-void ChessBoard::initialise_board() {
+void ChessBoard::initialise_board(bool quiet) {
+  const int back_rank[8] = {CASTLE, KNIGHT, BISHOP, QUEEN, KING, BISHOP, KNIGHT, CASTLE};
+
+  position.clear();
+
   /* Create Pawns */
   for (int file = 0; file < 8; file++) {
-    chess_map[1][file] = new Pawn('P', 1, file, 'B');
-    chess_map[6][file] = new Pawn('P', 6, file, 'W');
+    position.put_piece(make_piece(BLACK, PAWN), make_square(6, file));
+    position.put_piece(make_piece(WHITE, PAWN), make_square(1, file));
   }
 
-  /* Create Knights */
-  chess_map[0][1] = new Knight('N', 0, 1, 'B');
-  chess_map[0][6] = new Knight('N', 0, 6, 'B');
-  chess_map[7][1] = new Knight('N', 7, 1, 'W');
-  chess_map[7][6] = new Knight('N', 7, 6, 'W');
+  /* Create Knights, Queens, Bishops, Castles and Kings */
+  for (int file = 0; file < 8; file++) {
+    position.put_piece(make_piece(BLACK, back_rank[file]), make_square(7, file));
+    position.put_piece(make_piece(WHITE, back_rank[file]), make_square(0, file));
+  }
+  checks = position.check_info();
 
-  /* Create Queens */
-  chess_map[0][3] = new Queen('Q', 0, 3, 'B');
-  chess_map[7][3] = new Queen('Q', 7, 3, 'W');
+  if (!quiet)
+    cout << "A new chess game is started!\n";
+}
 
-  /* Create Bishops */
-  chess_map[0][2] = new Bishop('B', 0, 2, 'B');
-  chess_map[0][5] = new Bishop('B', 0, 5, 'B');
-  chess_map[7][2] = new Bishop('B', 7, 2, 'W');
-  chess_map[7][5] = new Bishop('B', 7, 5, 'W');
+/* -------------------- Game management -------------------- */
+MoveResult ChessBoard::submitMove(const char from[], const char to[], bool quiet) {
+  MoveResult result = submit_move(Point(from).to_square(), Point(to).to_square());
 
-  /* Create Castles */
-  chess_map[0][0] = new Castle('C', 0, 0, 'B');
-  chess_map[0][7] = new Castle('C', 0, 7, 'B');
-  chess_map[7][0] = new Castle('C', 7, 0, 'W');
-  chess_map[7][7] = new Castle('C', 7, 7, 'W');
+  if (!quiet)
+    print_move_result(cout, result, from, to);
+  return result;
+}
 
-  /* Create Kings */
-  chess_map[0][4] = new King('K', 0, 4, 'B');
-  chess_map[7][4] = new King('K', 7, 4, 'W');
+MoveResult ChessBoard::submit_move(Square from_square, Square to_square) {
+  MoveResult result;
 
-  cout << "A new chess game is started!" << endl;
-}
+  result.from = from_square;
+  result.to = to_square;
 
-/* -------------------- Game management -------------------- */
-void ChessBoard::submitMove(const char from[], const char to[]) {
-  Point from_pos(from);
-  Point to_pos(to);
-  ChessPiece* removed_piece;
-
-  // check from_pos not empty
-  if (chess_map[from_pos.get_rank()][from_pos.get_file()] == NULL) {
-    cout << "There is no piece at position " << from_pos << "!" << endl;
-    return;
+  // check from_square not empty
+  if (!from_square.valid() || piece_at(from_square).empty()) {
+    result.status = MOVE_NO_PIECE;
+    return result;
   }
+  result.moved = static_cast<uint8_t>(position.piece_on(from_square));
 
-  if (!check_turn(from_pos))
-    return;
-
-  if (!valid_move(from, to, true))
-    return;
+  if (!check_turn(from_square))
+    result.status = MOVE_WRONG_TURN;
+  else if (!to_square.valid())
+    result.status = MOVE_OFF_BOARD;
+  else if (!valid_move(from_square, to_square))
+    result.status = MOVE_ILLEGAL;
 
   // check the move won't put current player in check
-  if (move_to_check(from_pos, to_pos))
-    return;
-
-  // if a pawn is to be moved, tell it to remember
-  remember_pawn_move(from_pos);
+  else if (move_to_check(from_square, to_square))
+    result.status = MOVE_INTO_CHECK;
 
-  removed_piece = move_piece(from_pos, to_pos);
-  delete removed_piece;
+  if (result.status == MOVE_PLAYED) {
+    result.captured = static_cast<uint8_t>(move_piece(from_square, to_square));
+    result.move = history[(moves_made - 1) % MAX_HISTORY].move;
+  }
 
-  // check for check, checkmate and stalemate
-  if (!check())
-    stalemate();
+  finish_move(result);
+  return result;
 }
 
-void ChessBoard::remember_pawn_move(Point from_pos) {
-  ChessPiece* piece_moved = chess_map[from_pos.get_rank()][from_pos.get_file()];
+MoveResult ChessBoard::submit_san(string_view san) {
+  MoveResult result;
+  Move move = san_move(san, result);
+
+  if (move == NO_MOVE)
+    result.status = MOVE_ILLEGAL;
+  else {
+    result.from = Square(move_from(move));
+    result.captured = static_cast<uint8_t>((move_flag(move) == EN_PASSANT) ? make_piece(position.side() ^ 1, PAWN) : position.piece_on(move_to(move)));
+    result.move = move;
+    make_move(move);
+  }
 
-  if (piece_moved->get_type() == 'P')
-    static_cast<Pawn*>(piece_moved)->check_first_move();
+  finish_move(result);
+  return result;
 }
 
-ChessPiece* ChessBoard::move_piece(Point from_pos, Point to_pos, bool print_message) {
-  ChessPiece* tmp = nullptr;
+ChessPiece ChessBoard::piece_at(Square square) {
+  return ChessPiece(position.piece_on(square));
+}
 
-  // if destination empty, update moving piece and print message
-  if (chess_map[to_pos.get_rank()][to_pos.get_file()] == NULL)
-    chess_map[from_pos.get_rank()][from_pos.get_file()]->take_position(from_pos, to_pos, print_message);
+Move ChessBoard::submitted_move(Square from_square, Square to_square) {
+  if (piece_type(position.piece_on(from_square)) == PAWN) {
+    // a pawn may not stay a pawn on the last rank
+    if ((to_square.rank() == 0) || (to_square.rank() == 7))
+      return create_move(from_square, to_square, PROMOTION, QUEEN);
 
-  // else update taking piece, print message and delete taken piece
-  else  {
-    chess_map[from_pos.get_rank()][from_pos.get_file()]->take_position(from_pos, to_pos, chess_map[to_pos.get_rank()][to_pos.get_file()], print_message);
-    tmp = chess_map[to_pos.get_rank()][to_pos.get_file()];
+    // nor leave the pawn it takes en passant behind
+    if ((to_square == position.en_passant_square()) && (from_square.file() != to_square.file()))
+      return create_move(from_square, to_square, EN_PASSANT);
   }
+  return create_move(from_square, to_square);
+}
 
-  // update board
-  chess_map[to_pos.get_rank()][to_pos.get_file()] = chess_map[from_pos.get_rank()][from_pos.get_file()];
-  chess_map[from_pos.get_rank()][from_pos.get_file()] = NULL;
+int ChessBoard::move_piece(Square from_square, Square to_square) {
+  Move move = submitted_move(from_square, to_square);
+  int taken_piece = (move_flag(move) == EN_PASSANT) ? make_piece(position.side() ^ 1, PAWN) : position.piece_on(to_square);
 
-  return tmp;
+  make_move(move);
+  return taken_piece;
 }
 
-void ChessBoard::resetBoard() {
-  for (int i = 0; i < 8; i++) {
-    for (int j = 0; j < 8; j++) {
-      delete chess_map[i][j];
-      chess_map[i][j] = nullptr;
-    }
-  }
-
+void ChessBoard::resetBoard(bool quiet) {
   moves_made = 0;
   current_turn = 'W';
-  initialise_board();
+  undoable_moves = 0;
+  initialise_board(quiet);
 }
 
-/* -------------------- Helpers -------------------- */
-bool ChessBoard::valid_move(Point from_pos, Point to_pos, bool print_errors) {
-  bool good_move = true;
+FenError ChessBoard::load_fen(string_view fen) {
+  FenError error = position.load_fen(fen);
 
-  // check valid destination
-  if (!(chess_map[from_pos.get_rank()][from_pos.get_file()]->valid_destination(to_pos)))
-    good_move = false;
+  if (error == FEN_OK)
+    resume_game();
+  return error;
+}
 
-  // check blocked path
-  else if (blocked_path(from_pos, to_pos))
-    good_move = false;
+string ChessBoard::to_fen() const {
+  return position.fen();
+}
 
-  // if piece can take other piece, move
-  else if (!chess_map[from_pos.get_rank()][from_pos.get_file()]->can_take(chess_map[to_pos.get_rank()][to_pos.get_file()], to_pos))
-    good_move = false;
+void ChessBoard::set_position(const Position &position) {
+  this->position = position;
+  resume_game();
+}
 
-  // print error if needed
-  if ((good_move == false) && (print_errors == true))
-    chess_map[from_pos.get_rank()][from_pos.get_file()]->print_move_error(to_pos);
-  return good_move;
+void ChessBoard::save_snapshot(Snapshot &snapshot) const {
+  position.save_snapshot(snapshot);
 }
 
-bool ChessBoard::check_turn(Point from_pos) {
-  if ((moves_made % 2) == 0) {
-    if (chess_map[from_pos.get_rank()][from_pos.get_file()]->get_colour() != 'W') {
-      cout << "It's not Black's turn to move!" << endl;
-      current_turn = 'W';
-      return false;
-    }
-  }
+FenError ChessBoard::load_snapshot(const Snapshot &snapshot) {
+  FenError error = position.load_snapshot(snapshot);
+
+  if (error == FEN_OK)
+    resume_game();
+  return error;
+}
+
+/* -------------------- Helpers -------------------- */
+void ChessBoard::resume_game() {
+  // count the moves a game from the starting position would have made
+  moves_made = 2 * (position.fullmoves() - 1) + position.side();
+  current_turn = (position.side() == WHITE) ? 'W' : 'B';
+  undoable_moves = 0;
+  checks = position.check_info();
+}
 
-  else if (chess_map[from_pos.get_rank()][from_pos.get_file()]->get_colour() != 'B') {
-    cout << "It's not White's turn to move!" << endl;
-    current_turn = 'W';
+bool ChessBoard::valid_move(Square from_square, Square to_square) {
+  ChessPiece piece = piece_at(from_square);
+
+  // check valid destination
+  if (!(piece.valid_destination(from_square, to_square, position.occupied())))
     return false;
-  }
 
-  moves_made ++;
-  return true;
+  // check blocked path
+  if (blocked_path(from_square, to_square))
+    return false;
+
+  // a pawn taking en passant moves diagonally onto the empty square the pawn it takes passed over
+  if ((piece_type(piece.code()) == PAWN) && (to_square == position.en_passant_square()) && (from_square.file() != to_square.file()))
+    return true;
+
+  // check piece can take any piece on the destination
+  return piece.can_take(piece_at(to_square), from_square, to_square);
+}
+
+bool ChessBoard::check_turn(Square from_square) {
+  return piece_colour(position.piece_on(from_square)) == position.side();
 }
 
 void ChessBoard::printBoard() {
@@ -176,545 +211,372 @@ void ChessBoard::printBoard() {
 
   for (int i = 0; i < 8; i++) {
     for (int j = 0; j < 8; j++) {
-      if (chess_map[i][j] == NULL)
+      ChessPiece piece = piece_at(Square(7 - i, j));
+      if (piece.empty())
         cout << setw(9) << "";
       else
-        cout << setw(9) << *chess_map[i][j];
+        cout << piece << "(" << i << "," << j << ")" << "| ";
     }
     cout << endl;
   }
   cout << endl;
 }
 
-bool ChessBoard::blocked_path(Point from_pos, Point to_pos) {
-  if (chess_map[from_pos.get_rank()][from_pos.get_file()]->get_type() == 'N')
-    return false;
-
-  vector<Point> path;
-  find_route(from_pos, to_pos, path);
-
-  for (auto point : path) {
-    if (chess_map[point.get_rank()][point.get_file()] != NULL) {
-      return true;
-    }
-  }
-  return false;
+bool ChessBoard::blocked_path(Square from_square, Square to_square) {
+  return (between[from_square][to_square] & position.occupied()) != 0;
 }
 
-void ChessBoard::find_route(Point from_pos, Point to_pos, vector<Point> &path) {
-  int rank_temp;
-  int file_temp;
-
-  int rank_diff = to_pos.get_rank() - from_pos.get_rank();
-  int file_diff = to_pos.get_file() - from_pos.get_file();
-
-  if (max(abs(rank_diff), abs(file_diff)) == 1)
-    return;
+Move ChessBoard::san_move(string_view san, MoveResult &result) {
+  int type = PAWN;
+  int promotion = 0;
+  int from_file = -1;
+  int from_rank = -1;
+  int castling = 0;
+  int us = position.side();
 
-  int rank_step = step(rank_diff);
-  int file_step = step(file_diff);
+  // check and annotation marks say nothing about the move itself
+  while (!san.empty() && (san.back() == '+' || san.back() == '#' || san.back() == '!' || san.back() == '?'))
+    san.remove_suffix(1);
 
-  rank_temp = from_pos.get_rank() + rank_step;
-  file_temp = from_pos.get_file() + file_step;
+  if ((san == "O-O") || (san == "0-0"))
+    castling = 1;
+  else if ((san == "O-O-O") || (san == "0-0-0"))
+    castling = -1;
 
-  path.push_back(Point(rank_temp, file_temp));
-
-  for (int i = 1; i < max(abs(rank_diff), abs(file_diff)) - 1; i++) {
-    rank_temp = path[i - 1].get_rank() + rank_step;
-    file_temp = path[i - 1].get_file() + file_step;
-
-    path.push_back(Point(rank_temp, file_temp));
+  if (castling) {
+    type = KING;
+    result.moved = static_cast<uint8_t>(make_piece(us, type));
+    result.to = Square(position.king_square(us) + 2 * castling);
   }
-}
+  else {
+    const char* letter = san.empty() ? NULL : strchr(san_letters, san[0]);
 
-int ChessBoard::step(int diff) {
-  if (diff > 0) return 1;
-  if (diff < 0) return -1;
-  return 0;
-}
-
-void ChessBoard::print_path(vector<Point> path) {
-  cout << "Path: ";
-  for (auto point : path) {
-    cout << point;
-  }
-  cout << endl;
-}
-
-void ChessBoard::find_kings(Point &white_king, Point &black_king) {
-  for (int rank = 0; rank < 8; rank++) {
-    for (int file = 0; file < 8; file++) {
-      if (chess_map[rank][file] == NULL)
-        continue;
-      else if ((chess_map[rank][file]->get_type() == 'K') && (chess_map[rank][file]->get_colour() == 'B'))
-        black_king = Point(rank, file);
-      else if ((chess_map[rank][file]->get_type() == 'K') && (chess_map[rank][file]->get_colour() == 'W'))
-        white_king = Point(rank, file);
-      }
+    if (letter && (*letter != '\0')) {
+      type = letter - san_letters;
+      san.remove_prefix(1);
     }
-  }
+    result.moved = static_cast<uint8_t>(make_piece(us, type));
 
-bool ChessBoard::in_check(Point king_location, char king_colour) {
-  for (int rank = 0; rank < 8; rank++) {
-    for (int file = 0; file < 8; file++) {
-      if (chess_map[rank][file] == NULL)
-        continue;
-      else if (chess_map[rank][file]->get_colour() == king_colour)
-        continue;
-
-      else {
-        Point attacker(rank, file);
-        if (valid_move(attacker, king_location, false))
-          return true;
-        }
-      }
-    }
-  return false;
-}
-
-bool ChessBoard::in_check(Point king_location) {
-  char king_colour = chess_map[king_location.get_rank()][king_location.get_file()]->get_colour();
+    // promotions are written e8=Q, or sometimes e8Q
+    if ((type == PAWN) && (san.size() >= 3)) {
+      const char* piece = strchr(san_letters + KNIGHT, san.back());
 
-  for (int rank = 0; rank < 8; rank++) {
-    for (int file = 0; file < 8; file++) {
-      if (chess_map[rank][file] == NULL)
-        continue;
-      else if (chess_map[rank][file]->get_colour() == king_colour)
-        continue;
-
-      else {
-        Point attacker(rank, file);
-        if (valid_move(attacker, king_location, false))
-          return true;
-        }
+      if (piece && (*piece != '\0') && (piece - san_letters < KING)) {
+        promotion = piece - san_letters;
+        san.remove_suffix((san[san.size() - 2] == '=') ? 2 : 1);
       }
     }
 
-  return false;
-}
-
-bool ChessBoard::check() {
-  Point white_king;
-  Point black_king;
-
-  find_kings(white_king, black_king);
-
-  if (in_check(black_king)) {
-    if (check_mate(black_king))
-      cout << "Black is in checkmate" << endl;
-    else cout << "Black is in check" << endl;
-    return true;
-  }
-  else if (in_check(white_king)) {
-    if (check_mate(white_king))
-      cout << "White is in checkmate" << endl;
-    else cout << "White is in check" << endl;
-    return true;
+    if (san.size() < 2)
+      return NO_MOVE;
+
+    char name[3] = {san[san.size() - 2], san[san.size() - 1], '\0'};
+    result.to = Square::parse(name);
+    if (!result.to.valid() || (name[0] < 'a'))
+      return NO_MOVE;
+
+    // anything between the piece and the destination disambiguates or marks a capture
+    for (char c : san.substr(0, san.size() - 2)) {
+      if ((c >= 'a') && (c <= 'h'))
+        from_file = c - 'a';
+      else if ((c >= '1') && (c <= '8'))
+        from_rank = c - '1';
+      else if (c != 'x')
+        return NO_MOVE;
+    }
   }
 
-  return false;
-}
+  int to = result.to;
+  int flag = NORMAL;
+  Bitboard occupied = position.occupied();
+  Bitboard sources = 0;
+
+  if (castling)
+    return position.legal(create_move(position.king_square(us), to, CASTLING), checks) ? create_move(position.king_square(us), to, CASTLING) : NO_MOVE;
+  if (position.pieces(us) & square_bb(to))
+    return NO_MOVE;
+
+  // only the pieces that could reach the destination are tried, rather than every legal move
+  switch (type) {
+    case PAWN: {
+      int forward = (us == WHITE) ? 8 : -8;
+      bool last_rank = (square_rank(to) == 0) || (square_rank(to) == 7);
+
+      // no pawn reaches its own first rank, and there is no square behind it to look at
+      if (square_rank(to) == ((us == WHITE) ? 0 : 7))
+        return NO_MOVE;
+
+      if ((from_file >= 0) && (from_file != square_file(to))) {
+        sources = pawn_attacks[us ^ 1][to] & position.pieces(us, PAWN);
+        if (to == position.en_passant_square())
+          flag = EN_PASSANT;
+        else if (position.piece_on(to) == NO_PIECE)
+          return NO_MOVE;
+      }
+      else if (position.piece_on(to) == NO_PIECE) {
+        // a single step, or a double step from the pawn's starting rank
+        if (position.piece_on(to - forward) == make_piece(us, PAWN))
+          sources = square_bb(to - forward);
+        else if ((square_rank(to) == ((us == WHITE) ? 3 : 4)) && (position.piece_on(to - forward) == NO_PIECE) &&
+                 (position.piece_on(to - 2 * forward) == make_piece(us, PAWN)))
+          sources = square_bb(to - 2 * forward);
+      }
 
-void ChessBoard::find_all_moves(Point from_pos, vector<Point> &possible_moves) {
-  for (int rank = 0; rank < 8; rank++) {
-    for (int file = 0; file < 8; file++) {
-      Point to_pos(rank, file);
-      if (valid_move(from_pos, to_pos, false))
-        possible_moves.push_back(to_pos);
+      if (last_rank != (promotion != 0))
+        return NO_MOVE;
+      if (last_rank)
+        flag = PROMOTION;
+      break;
     }
+    case KNIGHT: sources = knight_attacks[to]; break;
+    case BISHOP: sources = bishop_attacks(to, occupied); break;
+    case CASTLE: sources = castle_attacks(to, occupied); break;
+    case QUEEN: sources = queen_attacks(to, occupied); break;
+    case KING: sources = king_attacks[to]; break;
   }
-}
+  sources &= position.pieces(us, type);
 
-bool ChessBoard::move_to_check(Point from_pos, Point to_pos) {
-  Point black_king;
-  Point white_king;
-  bool simulation_result;
+  Move found = NO_MOVE;
+  int matches = 0;
 
-  find_kings(white_king, black_king);
+  while (sources) {
+    int from = pop_lsb(sources);
+    Move move = create_move(from, to, flag, promotion ? promotion : 1);
 
-  if (chess_map[from_pos.get_rank()][from_pos.get_file()]->get_colour() == 'W')
-    simulation_result = simulate_move_check(from_pos, to_pos, white_king);
-  else
-    simulation_result = simulate_move_check(from_pos, to_pos, black_king);
+    if (((from_file >= 0) && (square_file(from) != from_file)) || ((from_rank >= 0) && (square_rank(from) != from_rank)))
+      continue;
+    if (!position.legal(move, checks))
+      continue;
 
-  if (simulation_result)
-    chess_map[from_pos.get_rank()][from_pos.get_file()]->print_move_error(to_pos);
+    found = move;
+    matches++;
+  }
 
-  return simulation_result;
+  return (matches == 1) ? found : NO_MOVE;
 }
 
-bool ChessBoard::simulate_move_check(Point from_pos, Point to_pos, Point king_location) {
-  ChessPiece *current_piece;
-  bool simulation_result = false;
-
-  // simulate move
-  current_piece = move_piece(from_pos, to_pos, false);
-
-  // check still in check
-  if (in_check(king_location))
-    simulation_result = true;
+Move ChessBoard::parse_san(string_view san) {
+  MoveResult result;
 
-  // reinstate the original pointer
-  move_piece(to_pos, from_pos, false);
-  chess_map[to_pos.get_rank()][to_pos.get_file()] = current_piece;
-
-  return simulation_result;
+  return san_move(san, result);
 }
 
-bool ChessBoard::check_mate(Point king_in_check) {
-  char attacker_colour = 'B';
-  if (chess_map[king_in_check.get_rank()][king_in_check.get_file()]->get_colour() == 'B')
-    attacker_colour = 'W';
-
-  /* escape by moving king */
-  // look at all points on board
-  for (int rank = 0; rank < 8; rank++) {
-    for (int file = 0; file < 8; file++) {
-      Point escape_route(rank, file);
-
-      // if king can move there
-      if (valid_move(king_in_check, escape_route, false)) {
-
-        // check if that positin is in check
-        if (!in_check(escape_route, attacker_colour)) {
-          return false;
-        }
-      }
-    }
-  }
-
-  /* escape by moving other pieces */
-  for (int rank = 0; rank < 8; rank++) {
-    for (int file = 0; file < 8; file++) {
-
-      if (chess_map[rank][file] == NULL)
-        continue;
-      else if (chess_map[rank][file]->get_colour() == attacker_colour)
-        continue;
-      else if (chess_map[rank][file]->get_type() == 'K')
-        continue;
-
-      Point from_pos(rank, file);
-      vector<Point> possible_moves;
-      find_all_moves(from_pos, possible_moves);
-
-      for (auto i : possible_moves) {
-        if (!simulate_move_check(from_pos, i, king_in_check))
-          return false;
-      }
-    }
+void ChessBoard::finish_move(MoveResult &result) {
+  // check for check, checkmate and stalemate
+  if (result.status == MOVE_PLAYED) {
+    result.check = check();
+    result.checkmate = result.check && check_mate();
+    result.stalemate = !result.check && stalemate();
   }
-
-  return true;
 }
 
-bool ChessBoard::stalemate() {
-  vector<Point> possible_moves;
-
-  for (int rank = 0; rank < 8; rank++) {
-    for (int file = 0; file < 8; file++) {
-
-      if (chess_map[rank][file] == NULL)
-        continue;
-      if (chess_map[rank][file]->get_colour() != current_turn)
-        continue;
-
-      find_all_moves(Point(rank, file), possible_moves);
-
-      if (!(possible_moves.empty()))
-        return false;
-      }
-    }
-
-  cout << "Game is in stalemate";
-  return true;
+bool ChessBoard::check() {
+  return checks.checkers != 0;
 }
 
-/* -------------------- ChessPiece -------------------- */
-/* -------------------- Constructor -------------------- */
-ChessPiece::ChessPiece(char type, int rank, int file, char colour) : type(type), rank(rank), file(file), colour(colour) {
-    switch(colour) {
-      case 'B': colour_long = "Black";
-                break;
-      case 'W': colour_long = "White";
-                break;
-    }
-
-    switch(type) {
-      case 'P': name = "Pawn";
-                break;
-      case 'N': name = "Knight";
-                break;
-      case 'Q': name = "Queen";
-                break;
-      case 'B': name = "Bishop";
-                break;
-      case 'C': name = "Castle";
-                break;
-      case 'K': name = "King";
-                break;
-    }
-};
-
-ChessPiece::~ChessPiece() {};
-
-/* -------------------- Helpers -------------------- */
-ostream& operator<<(ostream& os, const ChessPiece& cp) {
-  os << setw(0) << cp.type << cp.colour << "(" << cp.rank << "," << cp.file << ")" << "| ";
-  return os;
+void ChessBoard::generate_legal_moves(MoveList &moves) {
+  position.generate_legal_moves(moves, checks);
 }
 
-bool ChessPiece::can_take(ChessPiece* other_piece, Point to_position) {
-  if (other_piece == NULL)
-    return true;
+bool ChessBoard::legal_move(Move move) {
+  return position.pseudo_legal(move) && position.legal(move, checks);
+}
 
-  if (type == 'P') {
-    if (file == to_position.get_file())
-      return false;
-  }
+void ChessBoard::make_move(Move move) {
+  MoveRecord &record = history[moves_made % MAX_HISTORY];
 
-  else if (other_piece->get_colour() == colour) {
-    return false;
-  }
+  record.move = move;
+  position.do_move(move, record.undo);
+  checks = position.check_info();
 
-  return true;
+  moves_made ++;
+  current_turn = (position.side() == WHITE) ? 'W' : 'B';
+  if (undoable_moves < MAX_HISTORY)
+    undoable_moves ++;
 }
 
-void ChessPiece::take_position(Point from_position, Point to_position, bool print_message) {
-  rank = to_position.get_rank();
-  file = to_position.get_file();
-  if (print_message)
-    cout << colour_long << "'s " << name << " moves from " << from_position << " to " << to_position << endl;
-}
+bool ChessBoard::unmake_move() {
+  if (undoable_moves == 0)
+    return false;
 
-void ChessPiece::take_position(Point from_position, Point to_position, ChessPiece *other_piece, bool print_message) {
-  rank = to_position.get_rank();
-  file = to_position.get_file();
-  if (print_message)
-    cout << colour_long << "'s " << name << " moves from " << from_position << " to " << to_position << " taking " << other_piece->colour_long << "'s " << other_piece->name  << endl;
-}
+  moves_made --;
+  undoable_moves --;
 
-char ChessPiece::get_colour() {
-  return colour;
+  const MoveRecord &record = history[moves_made % MAX_HISTORY];
+  position.undo_move(record.move, record.undo);
+  checks = position.check_info();
+  current_turn = (position.side() == WHITE) ? 'W' : 'B';
+  return true;
 }
 
-char ChessPiece::get_type() {
-  return type;
+Key ChessBoard::hash() {
+  return position.hash();
 }
 
-bool ChessPiece::out_of_bounds(Point position) {
-  int rank = position.get_rank();
-  int file = position.get_file();
+SearchResult ChessBoard::search(const SearchLimits &limits, TranspositionTable &table) {
+  Search search(position, table);
 
-  if ((rank < 0) || (file < 0) || (rank > 7) || (file > 7))
-    return true;
+  // the positions before each move that can be taken back, oldest first
+  for (int i = moves_made - undoable_moves; i < moves_made; i++)
+    search.add_game_key(history[i % MAX_HISTORY].undo.key);
 
-  return false;
+  return search.run(limits);
 }
 
-void ChessPiece::print_move_error(Point position) {
-  cout << colour_long << "'s " << name << " cannot move to " << position << "!" << endl;
+bool ChessBoard::move_to_check(Square from_square, Square to_square) {
+  return simulate_move_check(from_square, to_square);
 }
 
-void ChessPiece::print_bounds_error(Point position) {
-  cout << "Position " << position << " is out out of bounds!" << endl;
+bool ChessBoard::simulate_move_check(Square from_square, Square to_square) {
+  return !position.legal(submitted_move(from_square, to_square), checks);
 }
 
-
-/* -------------------- Pawn -------------------- */
-/* -------------------- Constructor -------------------- */
-Pawn::Pawn(char type, int rank, int file, char colour) : ChessPiece(type, rank, file, colour), first_move(true) {};
-
-Pawn::~Pawn() {};
-
-/* -------------------- Helpers -------------------- */
-void Pawn::check_first_move() {
-  if (first_move == true)
-    first_move = false;
-}
-
-bool Pawn::valid_destination(Point to_position) {
-  bool valid = true;
-  int rank_diff = to_position.get_rank() - rank;
-  int file_diff = to_position.get_file() - file;
-
-  if (out_of_bounds(to_position)) {
-    print_bounds_error(to_position);
+bool ChessBoard::check_mate() {
+  // without check, having no move is stalemate
+  if (!check())
     return false;
-  }
-
-  // can't move sideways
-   if (!((abs(file_diff) == 1) || (file_diff == 0))) {
-     valid = false;
-   }
 
-   // can only move one or two squares forward
-   else if (colour == 'B') {
-     if (!((rank_diff == 1) || ((first_move) && rank_diff == 2)))
-       valid = false;
+  MoveList possible_moves;
+  generate_legal_moves(possible_moves);
 
-     // can move diagonally
-     else if ((abs(file_diff) == 1) && (rank_diff == 1))
-       valid = true;
-   }
-   else if (colour == 'W') {
-     if (!((rank_diff == -1) || ((first_move) && rank_diff == -2)))
-       valid = false;
-
-     // can move diagonally
-     else if ((abs(file_diff) == 1) && (rank_diff == -1))
-       valid = true;
-   }
-
-  return valid;
+  return possible_moves.empty();
 }
 
+bool ChessBoard::stalemate() {
+  MoveList possible_moves;
+  generate_legal_moves(possible_moves);
 
-/* -------------------- Knight -------------------- */
-/* -------------------- Constructor -------------------- */
-Knight::Knight(char type, int rank, int file, char colour) : ChessPiece(type, rank, file, colour) {};
-
-Knight::~Knight() {};
+  return !check() && possible_moves.empty();
+}
 
-/* -------------------- Helpers -------------------- */
-bool Knight::valid_destination(Point to_position) {
-  bool valid = false;
-  int rank_diff = to_position.get_rank() - rank;
-  int file_diff = to_position.get_file() - file;
+/* -------------------- MoveResult -------------------- */
+void print_move_result(ostream &os, const MoveResult &result, const char from[], const char to[]) {
+  // echo what was typed for squares that could not be read
+  if (result.status == MOVE_NO_PIECE) {
+    if (from != NULL)
+      os << "There is no piece at position " << from << "!\n";
+    else
+      os << "There is no piece at position " << result.from << "!\n";
+    return;
+  }
 
-  if (out_of_bounds(to_position)) {
-    print_bounds_error(to_position);
-    return false;
+  // every other result has a piece that was or was not moved
+  const char* colour = colour_names[piece_colour(result.moved)];
+  const char* name = piece_names[piece_type(result.moved)];
+
+  switch (result.status) {
+    case MOVE_WRONG_TURN:
+      os << "It's not " << colour << "'s turn to move!\n";
+      return;
+    case MOVE_OFF_BOARD:
+      if (to != NULL)
+        os << "Position " << to << " is out out of bounds!\n";
+      else
+        os << "Position " << result.to << " is out out of bounds!\n";
+      return;
+    case MOVE_ILLEGAL:
+    case MOVE_INTO_CHECK:
+      os << colour << "'s " << name << " cannot move to " << result.to << "!\n";
+      return;
+    case MOVE_NO_PIECE:
+    case MOVE_PLAYED:
+      break;
   }
 
-  else if (abs(rank_diff) == 2)
-    valid = (abs(file_diff) == 1);
-  else if (abs(rank_diff) == 1)
-    valid = (abs(file_diff) == 2);
+  os << colour << "'s " << name << " moves from " << result.from << " to " << result.to;
+  if (result.captured != NO_PIECE)
+    os << " taking " << colour_names[piece_colour(result.captured)] << "'s " << piece_names[piece_type(result.captured)];
+  os << "\n";
 
-  return valid;
+  // the side now to move is the one in check
+  const char* opponent = colour_names[piece_colour(result.moved) ^ 1];
+  if (result.checkmate)
+    os << opponent << " is in checkmate\n";
+  else if (result.check)
+    os << opponent << " is in check\n";
+  else if (result.stalemate)
+    os << "Game is in stalemate\n";
 }
 
+/* -------------------- ChessPiece -------------------- */
 
-/* -------------------- Queen -------------------- */
-/* -------------------- Constructor -------------------- */
-Queen::Queen(char type, int rank, int file, char colour) : ChessPiece(type, rank, file, colour) {};
-
-Queen::~Queen() {};
+/* Return the squares a piece of Type and colour on from may move to by its movement rules,
+   with occupied squares blocking sliders */
+template<int Type> static Bitboard destinations(int colour, int from, Bitboard occupied);
 
-/* -------------------- Helpers -------------------- */
-// TODO move error print ot helper function in Queen or even ChessPiece?
-bool Queen::valid_destination(Point to_position) {
-  bool valid = false;
-  int rank_diff = to_position.get_rank() - rank;
-  int file_diff = to_position.get_file() - file;
-
-  if (out_of_bounds(to_position)) {
-    print_bounds_error(to_position);
-    return false;
-  }
+template<> Bitboard destinations<PAWN>(int colour, int from, Bitboard) {
+  return pawn_pushes[colour][from] | pawn_attacks[colour][from];
+}
 
-  // no movement
-  if ((rank_diff == 0) && (file_diff == 0))
-    valid = false;
+template<> Bitboard destinations<KNIGHT>(int, int from, Bitboard) {
+  return knight_attacks[from];
+}
 
-  // castle behaviour - only on is zero
-  else if ((rank_diff == 0) || (file_diff == 0))
-    valid = true;
+template<> Bitboard destinations<BISHOP>(int, int from, Bitboard occupied) {
+  return bishop_attacks(from, occupied);
+}
 
-  // bishop behaviour - abs diff ==
-  else if (abs(rank_diff) == abs(file_diff))
-    valid = true;
+template<> Bitboard destinations<CASTLE>(int, int from, Bitboard occupied) {
+  return castle_attacks(from, occupied);
+}
 
-  return valid;
+template<> Bitboard destinations<QUEEN>(int, int from, Bitboard occupied) {
+  return queen_attacks(from, occupied);
 }
 
+template<> Bitboard destinations<KING>(int, int from, Bitboard) {
+  return king_attacks[from];
+}
 
-/* -------------------- Bishop -------------------- */
 /* -------------------- Constructor -------------------- */
-Bishop::Bishop(char type, int rank, int file, char colour) : ChessPiece(type, rank, file, colour) {};
-
-Bishop::~Bishop() {};
-
-/* -------------------- Helpers -------------------- */
-bool Bishop::valid_destination(Point to_position) {
-  bool valid = false;
-  int rank_diff = to_position.get_rank() - rank;
-  int file_diff = to_position.get_file() - file;
-
-  if (out_of_bounds(to_position)) {
-    print_bounds_error(to_position);
-    return false;
+ChessPiece::ChessPiece(char type, char colour) : piece(NO_PIECE) {
+  for (int i = PAWN; i <= KING; i++) {
+    if (piece_letters[i] == type)
+      piece = static_cast<uint8_t>(make_piece(colour_index(colour), i));
   }
-
-  // no movement
-  if ((rank_diff == 0) && (file_diff == 0))
-    valid = false;
-
-  // bishop behaviour - abs diff ==
-  else if (abs(rank_diff) == abs(file_diff))
-    valid = true;
-
-  return valid;
 }
 
-
-/* -------------------- Castle -------------------- */
-/* -------------------- Constructor -------------------- */
-Castle::Castle(char type, int rank, int file, char colour) : ChessPiece(type, rank, file, colour) {};
-
-Castle::~Castle() {};
-
 /* -------------------- Helpers -------------------- */
-bool Castle::valid_destination(Point to_position) {
-  bool valid = false;
-  int rank_diff = to_position.get_rank() - rank;
-  int file_diff = to_position.get_file() - file;
+ostream& operator<<(ostream& os, const ChessPiece& cp) {
+  os << setw(0) << cp.get_type() << cp.get_colour();
+  return os;
+}
 
-  if (out_of_bounds(to_position)) {
-    print_bounds_error(to_position);
+bool ChessPiece::can_take(ChessPiece other_piece, Square from_square, Square to_square) const {
+  // pawns only take diagonally, and only move diagonally to take
+  if ((piece_type(piece) == PAWN) && ((from_square.file() == to_square.file()) != other_piece.empty()))
     return false;
-  }
-
-  // no movement
-  if ((rank_diff == 0) && (file_diff == 0))
-    valid = false;
 
-  // castle behaviour - only on is zero
-  else if ((rank_diff == 0) || (file_diff == 0))
-    valid = true;
+  if (other_piece.empty())
+    return true;
 
-  return valid;
+  // no piece takes its own side, pawns included
+  return piece_colour(other_piece.piece) != piece_colour(piece);
 }
 
+char ChessPiece::get_colour() const {
+  return colour_letters[piece_colour(piece)];
+}
 
-/* -------------------- King -------------------- */
-/* -------------------- Constructor -------------------- */
-King::King(char type, int rank, int file, char colour) : ChessPiece(type, rank, file, colour) {};
-
-King::~King() {};
-
-
-/* -------------------- Helpers -------------------- */
-bool King::valid_destination(Point to_position) {
-  bool valid = false;
-  int rank_diff = to_position.get_rank() - rank;
-  int file_diff = to_position.get_file() - file;
-
-  if (out_of_bounds(to_position)) {
-    print_bounds_error(to_position);
-    return false;
-  }
+char ChessPiece::get_type() const {
+  return piece_letters[piece_type(piece)];
+}
 
-  // no movement
-  if ((rank_diff == 0) && (file_diff == 0))
-    valid = false;
+bool ChessPiece::valid_destination(Square from_square, Square to_square, Bitboard occupied) const {
+  int colour = piece_colour(piece);
+  int from = from_square;
+  Bitboard reachable = 0;
 
-  else if ((abs(rank_diff) <= 1) && (abs(file_diff) <= 1)) {
-    valid = true;
+  switch (piece_type(piece)) {
+    case PAWN: reachable = destinations<PAWN>(colour, from, occupied); break;
+    case KNIGHT: reachable = destinations<KNIGHT>(colour, from, occupied); break;
+    case BISHOP: reachable = destinations<BISHOP>(colour, from, occupied); break;
+    case CASTLE: reachable = destinations<CASTLE>(colour, from, occupied); break;
+    case QUEEN: reachable = destinations<QUEEN>(colour, from, occupied); break;
+    case KING: reachable = destinations<KING>(colour, from, occupied); break;
   }
 
-  return valid;
+  return (reachable & square_bb(to_square)) != 0;
 }
 
 
@@ -748,4 +610,13 @@ int Point::get_rank() {
 
 int Point::get_file() {
   return file;
+}
+
+Square Point::to_square() const {
+  if (position != "")
+    return Square::parse(position.c_str());
+
+  if ((rank < 0) || (rank > 7) || (file < 0) || (file > 7))
+    return Square();
+  return Square(7 - rank, file);
 }
\ No newline at end of file
@@ -1,223 +1,270 @@
 #include<string>
-#include<vector>
 
 using namespace std;
 
+#include"Position.h"
+#include"Search.h"
+#include"Square.h"
+
 class ChessPiece;
 class Point;
 
-/* Handles all board and game management. */
+/* Why a submitted move was or was not played */
+enum MoveStatus {
+  MOVE_PLAYED,
+  /* The source square is empty or not on the board */
+  MOVE_NO_PIECE,
+  /* The piece belongs to the side not to move */
+  MOVE_WRONG_TURN,
+  /* The destination is not on the board */
+  MOVE_OFF_BOARD,
+  /* The piece cannot move to the destination */
+  MOVE_ILLEGAL,
+  /* The move would leave the mover's king in check */
+  MOVE_INTO_CHECK
+};
+
+/* The outcome of a submitted move, with no I/O attached */
+struct MoveResult {
+  MoveStatus status;
+  Square from;
+  Square to;
+  /* The move played, or NO_MOVE */
+  Move move;
+  /* Piece codes of the piece moved and the piece taken, or NO_PIECE */
+  uint8_t moved;
+  uint8_t captured;
+  /* State of the side now to move, once the move is played */
+  bool check;
+  bool checkmate;
+  bool stalemate;
+
+  MoveResult() : status(MOVE_PLAYED), move(NO_MOVE), moved(NO_PIECE), captured(NO_PIECE), check(false), checkmate(false), stalemate(false) {}
+};
+
+/* Print the messages for result, as submitMove does unless quiet. from and to are the text
+   submitted, echoed for squares that could not be read; if NULL the squares are printed. */
+void print_move_result(ostream &os, const MoveResult &result, const char from[] = NULL, const char to[] = NULL);
+
+/* Handles all board and game management. Holds no pointers, so a game can be
+   copied, handed to another thread or kept in a container like any value. */
 class ChessBoard {
 private:
-  ChessPiece* chess_map[8][8];
+  /* A move played and the state it overwrote */
+  struct MoveRecord {
+    Move move;
+    Undo undo;
+  };
+
+  /* Number of most recent moves that can be taken back */
+  static const int MAX_HISTORY = 1024;
+
+  Position position;
+  /* Checks and pins against the side to move, refreshed after every move */
+  CheckInfo checks;
   int moves_made;
   char current_turn;
+  /* Ring of the most recent moves, indexed by moves_made */
+  MoveRecord history[MAX_HISTORY];
+  int undoable_moves;
 
 public:
   /* -------------------- Constructors -------------------- */
-  ChessBoard();
+  /* Start a new game, announcing it unless quiet */
+  explicit ChessBoard(bool quiet = false);
 
-  void initialise_board();
+  void initialise_board(bool quiet = false);
 
   /* -------------------- Game management -------------------- */
-  /* Perform move on chess board. Print move/error message. */
-  void submitMove(const char from[], const char to[]);
+  /* Perform move on chess board and return the outcome. Print move/error message unless quiet. */
+  MoveResult submitMove(const char from[], const char to[], bool quiet = false);
+  /* Perform move on chess board and return the outcome, printing nothing. Pawns reaching the last rank become queens,
+     and pawns may take en passant. */
+  MoveResult submit_move(Square from_square, Square to_square);
+  /* Play the legal move written in standard algebraic notation, e.g. Nf3, exd5, e8=Q or O-O,
+     and return the outcome, printing nothing. Ambiguous or unreadable moves are MOVE_ILLEGAL. */
+  MoveResult submit_san(string_view san);
   /* Remove all pieces from chess board */
-  void resetBoard();
+  void resetBoard(bool quiet = false);
   /* Print the current chess maps */
   void printBoard();
 
+  /* Set up the position described by a FEN string as a game in progress, with no moves to
+     take back. Return FEN_OK, or why the string cannot be read, leaving the board unchanged. */
+  FenError load_fen(string_view fen);
 
-private:
-  /* -------------------- Helpers -------------------- */
-  /* If pawn was moved, tell it to update move counter */
-  void remember_pawn_move(Point from_pos);
+  /* Return the current position as a FEN string */
+  string to_fen() const;
 
-  /* Return true if a move from_pos to_pos is valid */
-  bool valid_move(Point from_pos, Point to_pos, bool print_errors);
+  /* Set up position as a game in progress, with no moves to take back */
+  void set_position(const Position &position);
 
-  /* Return true if it is the current player's turn */
-  bool check_turn(Point from_pos);
+  /* Return the current position */
+  const Position& get_position() const { return position; }
+
+  /* Save the game to snapshot. The move count and turn follow from the move number and side to move. */
+  void save_snapshot(Snapshot &snapshot) const;
+
+  /* Resume the game saved in snapshot, with no moves to take back. Return FEN_OK, or why the
+     snapshot cannot be read, leaving the board unchanged. */
+  FenError load_snapshot(const Snapshot &snapshot);
+
+  /* -------------------- Moves -------------------- */
+  /* Add every legal move for the side to move to moves */
+  void generate_legal_moves(MoveList &moves);
 
-  /* Move a piece on the chessboard and update piece's internal location */
-  ChessPiece* move_piece(Point from_pos, Point to_pos, bool print_message = true);
+  /* Return true if move, which may be any 16-bit value, is legal for the side to move */
+  bool legal_move(Move move);
 
-  /* Return true if the path between to positions on the board is blocked */
-  bool blocked_path(Point from_pos, Point to_pos);
+  /* Play a legal move without printing anything */
+  void make_move(Move move);
 
-  /* Save a direct route between two positions to path vector */
-  void find_route(Point from_pos, Point to_pos, vector<Point> &path);
+  /* Take back the last move played. Return false if there is none to take back. */
+  bool unmake_move();
 
-  /* Print the contents of the path vector */
-  void print_path(vector<Point> path);
+  /* Return the Zobrist key of the current position */
+  Key hash();
 
-  /* Calculate the directon of travel between two positions on the board */
-  int step(int diff);
+  /* Return the legal move written in standard algebraic notation, or NO_MOVE if there is not exactly one */
+  Move parse_san(string_view san);
 
-  /* Save locations of the two kings to the positions provided */
-  void find_kings(Point &white_king, Point &black_king);
+  /* -------------------- Game state -------------------- */
+  /* Return the side to move, W or B */
+  char get_turn() const { return current_turn; }
 
-  /* Return true if a king is in check and print message */
+  /* Return true if the side to move is in check */
   bool check();
 
-  /* Find all positions to which the piece at from_pos can move */
-  void find_all_moves(Point from_pos, vector<Point> &possible_moves);
+  /* Return true if the side to move, being in check, has no legal move */
+  bool check_mate();
 
-  /* Simulate move and return true if would put king in check */
-  bool simulate_move_check(Point from_pos, Point to_pos, Point king_location);
+  /* Return true if game is in stalemate */
+  bool stalemate();
 
-  /* Return true if would would put current player's king in check */
-  bool move_to_check(Point from_pos, Point to_pos);
+  /* -------------------- Search -------------------- */
+  /* Search the current position within limits, sharing results through table, and return the best move found */
+  SearchResult search(const SearchLimits &limits, TranspositionTable &table);
 
-  /* Return true if a king is in chekmate and print notice */
-  bool check_mate(Point king_in_check);
 
-  /* Return true the the king at king_location is in check */
-  bool in_check(Point king_location);
+private:
+  /* -------------------- Helpers -------------------- */
+  /* Set the move count, turn and checks to carry on from a position just set up, and log a new game */
+  void resume_game();
 
-  /* Return true if king incheck from opponent with attacker colour */
-  bool in_check(Point king_location, char attacker_colour);
+  /* Return the piece on square, which is empty if there is none */
+  ChessPiece piece_at(Square square);
+
+  /* Return true if a move from_square to_square follows the movement rules */
+  bool valid_move(Square from_square, Square to_square);
+
+  /* Return true if it is the current player's turn */
+  bool check_turn(Square from_square);
+
+  /* Return the move that submitting a piece from_square to_square plays. A pawn reaching the last rank becomes a queen,
+     and one moving diagonally onto the en passant square takes en passant. */
+  Move submitted_move(Square from_square, Square to_square);
+
+  /* Play a move on the chessboard and return the piece taken, if any */
+  int move_piece(Square from_square, Square to_square);
+
+  /* Return true if the path between to squares on the board is blocked */
+  bool blocked_path(Square from_square, Square to_square);
+
+  /* Return the legal move written as san, or NO_MOVE if there is not exactly one.
+     Fills in the piece and destination san names in result for error messages. */
+  Move san_move(string_view san, MoveResult &result);
+
+  /* Set the check, checkmate and stalemate flags of result for a move just played */
+  void finish_move(MoveResult &result);
+
+  /* Return true if a move would leave the moving side's king in check */
+  bool simulate_move_check(Square from_square, Square to_square);
+
+  /* Return true if would would put current player's king in check */
+  bool move_to_check(Square from_square, Square to_square);
 
-  /* Return true if game is in stalemate */
-  bool stalemate();
 
 };
 
+static_assert(std::is_trivially_copyable<ChessBoard>::value, "ChessBoard must copy as plain memory");
+
 /* -------------------- ChessPiece -------------------- */
-/* Handles chess piece represenation and properties. Does not alter the board. */
+/* Handles chess piece represenation and properties. Does not alter the board.
+   A piece is just its 4-bit piece code; rules are looked up by type and names
+   are only produced when printing. */
 class ChessPiece {
 protected:
-  char type;
-  int rank;
-  int file;
-  char colour;
-  bool in_play;
-  string colour_long;
-  string name;
-
-  /* Return true is position is not on the board */
-  bool out_of_bounds(Point position);
-
-  /* Print destination out of bounds error message */
-  void print_bounds_error(Point position);
+  uint8_t piece;
 
 public:
-  /* Print position movement error message */
-  void print_move_error(Point position);
-
   /* -------------------- Constructors -------------------- */
-  ChessPiece(char type, int rank, int file, char colour);
-  virtual ~ChessPiece();
+  /* The piece with code piece, or no piece at all for NO_PIECE */
+  explicit ChessPiece(int piece = NO_PIECE) : piece(static_cast<uint8_t>(piece)) {}
+
+  /* The piece of type (P, N, B, C, Q or K) and colour (W or B) */
+  ChessPiece(char type, char colour);
 
   /* -------------------- Helpers -------------------- */
   friend ostream& operator<<(ostream& os, const ChessPiece& cp);
 
-  /* Return true if piece can take position (different colour, not check etc.) */
-  bool can_take(ChessPiece* other_piece, Point to_position);
+  /* Return true if this stands for an empty square */
+  bool empty() const { return piece == NO_PIECE; }
 
-  /* Change piece's internal location to reflect empty to_position and print message */
-  void take_position(Point from_position, Point to_position, bool print_message);
+  /* Return the piece code */
+  int code() const { return piece; }
 
-  /* Change piece's internal location to reflect to_position and print message */
-  void take_position(Point from_position, Point to_position, ChessPiece *other_piece, bool print_message);
+  /* Return true if piece can move onto a square holding other_piece, or nothing: never its own side, and for a pawn,
+     only diagonally to take. En passant, onto an empty square, is left to the board. */
+  bool can_take(ChessPiece other_piece, Square from_square, Square to_square) const;
 
   /* Return the piece's colour */
-  char get_colour();
+  char get_colour() const;
 
   /* Return the piece's type */
-  char get_type();
+  char get_type() const;
 
-  /* -------------------- Virtual Functions -------------------- */
-  /* Return true if piece is able to move to location */
-  virtual bool valid_destination(Point to_position) = 0;
+  /* Return true if piece is able to move from from_square to to_square past the occupied squares */
+  bool valid_destination(Square from_square, Square to_square, Bitboard occupied) const;
 };
 
+static_assert(sizeof(ChessPiece) == 1, "ChessPiece must stay a bare piece code");
 
-/* -------------------- Pawn -------------------- */
-class Pawn : public ChessPiece {
-private:
-  bool first_move;
 
+/* -------------------- Pieces -------------------- */
+/* Named pieces of colour (W or B), kept for code written against the old class hierarchy */
+class Pawn : public ChessPiece {
 public:
-  /* -------------------- Constructors -------------------- */
-  Pawn(char type, int rank, int file, char colour);
-  virtual ~Pawn();
-
-  /* -------------------- Public Helper -------------------- */
-  void check_first_move();
-
-  /* -------------------- Virtual Functions -------------------- */
-  /* Return true if Pawn is able to move to location */
-  virtual bool valid_destination(Point to_position);
+  explicit Pawn(char colour) : ChessPiece('P', colour) {}
 };
 
-
-/* -------------------- Knight -------------------- */
 class Knight : public ChessPiece {
 public:
-  /* -------------------- Constructors -------------------- */
-  Knight(char type, int rank, int file, char colour);
-  virtual ~Knight();
-
-  /* -------------------- Virtual Functions -------------------- */
-  /* Return true if Knight is able to move to location */
-  virtual bool valid_destination(Point to_position);
+  explicit Knight(char colour) : ChessPiece('N', colour) {}
 };
 
-
-/* -------------------- Queen -------------------- */
 class Queen : public ChessPiece {
 public:
-  /* -------------------- Constructors -------------------- */
-  Queen(char type, int rank, int file, char colour);
-  virtual ~Queen();
-
-  /* -------------------- Virtual Functions -------------------- */
-  /* Return true if Queen is able to move to location */
-  virtual bool valid_destination(Point to_position);
+  explicit Queen(char colour) : ChessPiece('Q', colour) {}
 };
 
-
-/* -------------------- Bishop -------------------- */
 class Bishop : public ChessPiece {
 public:
-  /* -------------------- Constructors -------------------- */
-  Bishop(char type, int rank, int file, char colour);
-  virtual ~Bishop();
-
-  /* -------------------- Virtual Functions -------------------- */
-  /* Return true if Bishop is able to move to location */
-  virtual bool valid_destination(Point to_position);
+  explicit Bishop(char colour) : ChessPiece('B', colour) {}
 };
 
-
-/* -------------------- Castle -------------------- */
 class Castle : public ChessPiece {
 public:
-  /* -------------------- Constructors -------------------- */
-  Castle(char type, int rank, int file, char colour);
-  virtual ~Castle();
-
-  /* -------------------- Virtual Functions -------------------- */
-  /* Return true if Castle is able to move to location */
-  virtual bool valid_destination(Point to_position);
+  explicit Castle(char colour) : ChessPiece('C', colour) {}
 };
 
-
-/* -------------------- King -------------------- */
 class King : public ChessPiece {
 public:
-  /* -------------------- Constructors -------------------- */
-  King(char type, int rank, int file, char colour);
-  virtual ~King();
-
-  /* -------------------- Virtual Functions -------------------- */
-  /* Return true if King is able to move to location */
-  virtual bool valid_destination(Point to_position);
+  explicit King(char colour) : ChessPiece('K', colour) {}
 };
 
 
-/* Represents points on a chess board */
+/* Represents points on a chess board as typed by the user. Only used to read
+   the text given to submitMove; everything past it works on Squares. */
 class Point {
 private:
   int rank;
@@ -238,4 +285,7 @@ public:
 
   /* Return the point's file */
   int get_file();
+
+  /* Return the square the point names, or no square if it is off the board */
+  Square to_square() const;
 };
@@ -1,10 +1,673 @@
 #include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <fstream>
+#include <chrono>
+#include <memory>
 
 using namespace std;
 
 #include "ChessBoard.h"
+#include "Perft.h"
+#include "Search.h"
+#include "Pgn.h"
+#include "Replay.h"
+#include "GameDatabase.h"
+#include "PositionIndex.h"
+#include "Checkpoint.h"
+#include "SessionManager.h"
+#include "EventLog.h"
+
+/* Print the command line options */
+static void print_usage() {
+  cout << "Usage: chess                     replay the example games" << endl;
+  cout << "       chess perft DEPTH [FEN]   count leaf nodes below each move" << endl;
+  cout << "       chess perft suite         check and time the reference positions" << endl;
+  cout << "       chess search [FEN]        find the best move" << endl;
+  cout << "       chess pgn [FILE...]       replay and check the games of PGN files, or of the input" << endl;
+  cout << "       chess db convert DB PGN...  store the legal games of PGN files in a new database" << endl;
+  cout << "       chess db add DB PGN...      add the legal games of PGN files to a database" << endl;
+  cout << "       chess db scan DB            replay every game of a database" << endl;
+  cout << "       chess db game DB N          print game N (from 1) of a database" << endl;
+  cout << "       chess db index DB           index the positions of games not yet in DB.idx" << endl;
+  cout << "       chess db find DB FEN [--limit N]  list the games reaching a position (default 20)" << endl;
+  cout << "       chess snapshot [--games N] [FILE]  time checkpointing N random games (default 1000000), to FILE if given, and check resuming" << endl;
+  cout << "       chess serve               play random games against a sharded session manager" << endl;
+  cout << endl;
+  cout << "Perft options:" << endl;
+  cout << "  --threads N   split the tree across N threads" << endl;
+  cout << "  --hash MB     share a MB megabyte hash of subtree counts (default 64 with threads)" << endl;
+  cout << endl;
+  cout << "Search options (default --depth 8):" << endl;
+  cout << "  --depth N     stop after N plies" << endl;
+  cout << "  --movetime MS stop after MS milliseconds" << endl;
+  cout << "  --nodes N     stop after N nodes" << endl;
+  cout << "  --hash MB     size of the transposition table (default 16)" << endl;
+  cout << "  --threads N   search on N threads sharing the table" << endl;
+  cout << endl;
+  cout << "PGN options:" << endl;
+  cout << "  --errors      only list the games that fail to check out" << endl;
+  cout << "  --threads N   replay on N threads, written out in order" << endl;
+  cout << "  --readers N   read and chunk N files at a time (default 1)" << endl;
+  cout << endl;
+  cout << "Serve options:" << endl;
+  cout << "  --shards N    handle games on N worker threads (default 4)" << endl;
+  cout << "  --clients N   make requests from N client threads (default 2)" << endl;
+  cout << "  --games N     keep N games going per client (default 256)" << endl;
+  cout << "  --seconds S   run for S seconds (default 2)" << endl;
+  cout << "  --log FILE    record every game and move in FILE as text" << endl;
+  cout << "  --binary-log FILE  record every game and move in FILE as 16-byte records" << endl;
+}
+
+/* Run the perft command. Return the process exit status. */
+static int run_perft(int argc, char* argv[]) {
+  vector<string> arguments;
+  int threads = 1;
+  int hash_megabytes = -1;
+
+  for (int i = 2; i < argc; i++) {
+    string argument = argv[i];
+
+    if ((argument == "--threads") && (i + 1 < argc))
+      threads = atoi(argv[++i]);
+    else if ((argument == "--hash") && (i + 1 < argc))
+      hash_megabytes = atoi(argv[++i]);
+    else
+      arguments.push_back(argument);
+  }
+
+  if (hash_megabytes < 0)
+    hash_megabytes = (threads > 1) ? 64 : 0;
+  bool parallel = (threads > 1) || (hash_megabytes > 0);
+
+  if (arguments.empty()) {
+    print_usage();
+    return 1;
+  }
+
+  if (arguments[0] == "suite")
+    return perft_suite(threads, hash_megabytes) ? 0 : 1;
+
+  char* end;
+  long depth = strtol(arguments[0].c_str(), &end, 10);
+  if ((*end != '\0') || (depth <= 0) || (depth > 64)) {
+    cout << "Cannot read depth " << arguments[0] << "!" << endl;
+    return 1;
+  }
+
+  Position position;
+  string fen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+  if (arguments.size() >= 2)
+    fen = arguments[1];
+
+  FenError error = position.load_fen(fen);
+  if (error != FEN_OK) {
+    cout << "Cannot read position " << fen << ": " << fen_error_message(error) << "!" << endl;
+    return 1;
+  }
+
+  if (parallel)
+    parallel_perft_divide(position, depth, threads, hash_megabytes);
+  else
+    perft_divide(position, depth);
+  return 0;
+}
+
+/* Run the search command. Return the process exit status. */
+static int run_search(int argc, char* argv[]) {
+  SearchLimits limits;
+  int hash_megabytes = 16;
+  string fen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+  for (int i = 2; i < argc; i++) {
+    string argument = argv[i];
+
+    if ((argument == "--depth") && (i + 1 < argc))
+      limits.depth = atoi(argv[++i]);
+    else if ((argument == "--movetime") && (i + 1 < argc))
+      limits.time_ms = atoll(argv[++i]);
+    else if ((argument == "--nodes") && (i + 1 < argc))
+      limits.nodes = strtoull(argv[++i], NULL, 10);
+    else if ((argument == "--hash") && (i + 1 < argc))
+      hash_megabytes = atoi(argv[++i]);
+    else if ((argument == "--threads") && (i + 1 < argc))
+      limits.threads = atoi(argv[++i]);
+    else
+      fen = argument;
+  }
+
+  if ((limits.depth == 0) && (limits.time_ms == 0) && (limits.nodes == 0))
+    limits.depth = 8;
+  limits.print_info = true;
+
+  Position position;
+
+  FenError error = position.load_fen(fen);
+  if (error != FEN_OK) {
+    cout << "Cannot read position " << fen << ": " << fen_error_message(error) << "!" << endl;
+    return 1;
+  }
+
+  TranspositionTable table(hash_megabytes);
+  Search search(position, table);
+  SearchResult result = search.run(limits);
+  TTStats stats = table.stats();
+
+  cout << "table " << (table.size_bytes() >> 20) << " MB hits " << stats.hits << " misses " << stats.misses
+       << " collisions " << stats.collisions << " fill " << stats.fill / 10.0 << "%" << endl;
+  if (result.thread_nodes.size() > 1) {
+    for (size_t i = 0; i < result.thread_nodes.size(); i++)
+      cout << "Thread " << i << ": " << result.thread_nodes[i] << " nodes" << endl;
+    cout << "Total: " << result.nodes << " nodes in " << result.seconds << " s" << endl;
+  }
+
+  if (result.best_move == NO_MOVE)
+    cout << "bestmove (none)" << endl;
+  else
+    cout << "bestmove " << move_to_uci(result.best_move) << endl;
+  return 0;
+}
+
+/* Run the pgn command. Return the process exit status. */
+static int run_pgn(int argc, char* argv[]) {
+  vector<string> files;
+  bool errors_only = false;
+  int threads = 1;
+  int readers = 1;
+
+  for (int i = 2; i < argc; i++) {
+    string argument = argv[i];
+
+    if (argument == "--errors")
+      errors_only = true;
+    else if ((argument == "--threads") && (i + 1 < argc))
+      threads = atoi(argv[++i]);
+    else if ((argument == "--readers") && (i + 1 < argc))
+      readers = atoi(argv[++i]);
+    else
+      files.push_back(argument);
+  }
+
+  if (files.empty())
+    files.push_back("-");
+
+  ReplayStats stats = ReplayStats();
+  bool all_read = true;
+
+  if (threads > 1) {
+    ReplayPipeline pipeline(threads, readers, errors_only);
+
+    all_read = pipeline.run(files, cout, stats);
+    print_replay_stats(cout, stats);
+    return (all_read && (stats.failed == 0)) ? 0 : 1;
+  }
+
+  ChessBoard board(true);
+  PgnGame game;
+  auto start = chrono::steady_clock::now();
+
+  for (const string &file : files) {
+    ifstream input;
+
+    if (file != "-") {
+      input.open(file, ios::binary);
+      if (!input) {
+        cout << "Cannot open " << file << "!" << endl;
+        all_read = false;
+        continue;
+      }
+    }
+
+    PgnReader reader((file == "-") ? cin : input);
+
+    while (reader.next_game(board, game)) {
+      stats.games++;
+      stats.plies += game.plies;
+      if (game.status != PGN_OK)
+        stats.failed++;
+
+      if (!errors_only || (game.status != PGN_OK)) {
+        if (files.size() > 1)
+          cout << file << " ";
+        print_pgn_game(cout, game);
+      }
+    }
+  }
+
+  stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  print_replay_stats(cout, stats);
+  return (all_read && (stats.failed == 0)) ? 0 : 1;
+}
+
+/* Run the db command. Return the process exit status. */
+static int run_db(int argc, char* argv[]) {
+  if (argc < 4) {
+    print_usage();
+    return 1;
+  }
+
+  string command = argv[2];
+  string path = argv[3];
+  auto start = chrono::steady_clock::now();
+
+  if ((command == "convert") || (command == "add")) {
+    GameDatabaseWriter writer;
+    ChessBoard board(true);
+    PgnGame game;
+    vector<Move> moves;
+    uint64_t skipped = 0;
+    uint64_t plies = 0;
+
+    if ((command == "convert") && !writer.open(path)) {
+      cout << "Cannot create " << path << "!" << endl;
+      return 1;
+    }
+    if ((command == "add") && !writer.append(path)) {
+      cout << "Cannot read database " << path << "!" << endl;
+      return 1;
+    }
+    uint64_t games_before = writer.size();
+
+    for (int i = 4; i < argc; i++) {
+      ifstream input(argv[i], ios::binary);
+
+      if (!input) {
+        cout << "Cannot open " << argv[i] << "!" << endl;
+        return 1;
+      }
+
+      PgnReader reader(input);
+
+      // games with a move that cannot be played are left out
+      while (reader.next_game(board, game, &moves)) {
+        if ((game.status == PGN_ILLEGAL_MOVE) || (game.status == PGN_BAD_FEN)) {
+          skipped++;
+          continue;
+        }
+        writer.add_game(moves.data(), moves.size(), game.result, reader.start_fen());
+        plies += moves.size();
+      }
+    }
+
+    if (!writer.close()) {
+      cout << "Cannot write " << path << "!" << endl;
+      return 1;
+    }
+    cout << writer.size() - games_before << " games and " << plies << " plies stored, " << skipped << " games with illegal moves left out in "
+         << chrono::duration<double>(chrono::steady_clock::now() - start).count() << " s" << endl;
+    return 0;
+  }
+
+  GameDatabase database;
+
+  if (!database.open(path)) {
+    cout << "Cannot read database " << path << "!" << endl;
+    return 1;
+  }
+
+  if (command == "scan") {
+    ChessBoard board(true);
+    ReplayStats stats = ReplayStats();
+    StoredGame game;
+
+    for (uint64_t i = 0; i < database.size(); i++) {
+      stats.games++;
+      if (!database.replay(i, board)) {
+        cout << "game " << i + 1 << ": cannot be replayed" << endl;
+        stats.failed++;
+      }
+      else if (database.game(i, game))
+        stats.plies += game.plies;
+    }
+
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    print_replay_stats(cout, stats);
+    return (stats.failed == 0) ? 0 : 1;
+  }
+
+  if ((command == "game") && (argc >= 5)) {
+    uint64_t number = strtoull(argv[4], NULL, 10);
+    ChessBoard board(true);
+    StoredGame game;
+
+    if ((number == 0) || !database.game(number - 1, game) || !database.replay(number - 1, board)) {
+      cout << "There is no game " << argv[4] << " in " << path << "!" << endl;
+      return 1;
+    }
+
+    cout << "game " << number << ": " << game_result_text(game.result) << ", " << game.plies << " plies" << endl;
+    if (!game.fen.empty())
+      cout << "from " << game.fen << endl;
+    for (int i = 0; i < game.plies; i++)
+      cout << move_to_uci(game.moves[i]) << (((i % 16 == 15) || (i == game.plies - 1)) ? "\n" : " ");
+    cout << "final position " << board.to_fen() << endl;
+    return 0;
+  }
+
+  // the position index of a database sits beside it
+  string index_path = path + ".idx";
+
+  if (command == "index") {
+    PositionIndexWriter writer;
+    ChessBoard board(true);
+
+    if (!writer.open(index_path)) {
+      cout << "Cannot open index " << index_path << "!" << endl;
+      return 1;
+    }
+
+    int64_t added = writer.add_games(database, board);
+    if ((added < 0) || !writer.close()) {
+      cout << "Cannot update index " << index_path << "!" << endl;
+      return 1;
+    }
+
+    PositionIndex index;
+    index.open(index_path);
+    cout << added << " games indexed";
+    if (writer.skipped() > 0)
+      cout << " (" << writer.skipped() << " damaged, left out)";
+    cout << ", " << index.size() << " games and " << index.posting_count() << " positions in "
+         << index.segment_count() << " segments, in " << chrono::duration<double>(chrono::steady_clock::now() - start).count() << " s" << endl;
+    return 0;
+  }
+
+  if ((command == "find") && (argc >= 5)) {
+    uint64_t limit = 20;
+    PositionIndex index;
+    ChessBoard board(true);
+    vector<Posting> postings;
+    StoredGame game;
+
+    for (int i = 5; i + 1 < argc; i++) {
+      if (string(argv[i]) == "--limit")
+        limit = strtoull(argv[++i], NULL, 10);
+    }
+
+    FenError error = board.load_fen(argv[4]);
+    if (error != FEN_OK) {
+      cout << "Cannot read position " << argv[4] << ": " << fen_error_message(error) << "!" << endl;
+      return 1;
+    }
+    if (!index.open(index_path)) {
+      cout << "Cannot read index " << index_path << "!" << endl;
+      return 1;
+    }
+    if (index.size() < database.size())
+      cout << "The index covers " << index.size() << " of " << database.size() << " games" << endl;
+
+    start = chrono::steady_clock::now();
+    uint64_t found = index.find(board, postings, limit);
+    double milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    cout << found << " games reach the position, found in " << milliseconds << " ms" << endl;
+    for (const Posting &posting : postings) {
+      cout << "game " << posting.game + 1 << " ply " << posting.ply;
+      if (database.game(posting.game, game))
+        cout << ": " << game_result_text(game.result);
+      cout << endl;
+    }
+    return 0;
+  }
+
+  print_usage();
+  return 1;
+}
+
+/* Return how many of the reviewed pawn submissions go wrong: an en passant capture submitted as D4 to E3 must take the
+   e4 pawn, and a pawn stepping diagonally onto an empty square must be refused. */
+static uint64_t check_pawn_submissions() {
+  ChessBoard board(true);
+  uint64_t mismatched = 0;
+
+  board.load_fen("rnbqkbnr/ppp1pppp/8/8/3pP3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 3");
+  MoveResult result = board.submit_move(Square::parse("D4"), Square::parse("E3"));
+  if ((result.status != MOVE_PLAYED) || (move_flag(result.move) != EN_PASSANT) || (result.captured != make_piece(WHITE, PAWN)) ||
+      (board.to_fen() != "rnbqkbnr/ppp1pppp/8/8/8/4p3/PPPP1PPP/RNBQKBNR w KQkq - 0 4"))
+    mismatched++;
+
+  board.resetBoard(true);
+  if (board.submit_move(Square::parse("A2"), Square::parse("B3")).status != MOVE_ILLEGAL)
+    mismatched++;
+  return mismatched;
+}
+
+/* Play game_count random games through ChessBoard::submit_move, resuming each from a snapshot and from its FEN
+   after every move, and count the promotions and en passant captures played. Before every move, each pawn step onto an
+   empty diagonal square other than the en passant square is submitted too, and must be refused. Return the number of
+   moves that went wrong. */
+static uint64_t check_submitted_games(int game_count, uint64_t &promotions, uint64_t &en_passant) {
+  const int MAX_PLIES = 200;
+  ChessBoard board(true);
+  ChessBoard resumed(true);
+  Key random = 0x2545F4914F6CDD1DULL;
+  uint64_t mismatched = 0;
+
+  promotions = 0;
+  en_passant = 0;
+  for (int i = 0; i < game_count; i++) {
+    board.resetBoard(true);
+
+    for (int ply = 0; ply < MAX_PLIES; ply++) {
+      MoveList moves;
+      MoveList submittable;
+
+      // submitting a piece from one square to another cannot castle, and promotes to a queen
+      board.generate_legal_moves(moves);
+      for (Move move : moves) {
+        if ((move_flag(move) == NORMAL) || (move_flag(move) == EN_PASSANT) || ((move_flag(move) == PROMOTION) && (promotion_type(move) == QUEEN)))
+          submittable.add(move);
+      }
+      if (submittable.empty())
+        break;
+
+      const Position &position = board.get_position();
+      for (int from = 0; from < 64; from++) {
+        if (position.piece_on(from) != make_piece(position.side(), PAWN))
+          continue;
+
+        int rank = Square(from).rank() + ((position.side() == WHITE) ? 1 : -1);
+        for (int file = Square(from).file() - 1; file <= Square(from).file() + 1; file += 2) {
+          if ((rank < 0) || (rank > 7) || (file < 0) || (file > 7))
+            continue;
+
+          Square to(rank, file);
+          if ((position.piece_on(to) == NO_PIECE) && (to != position.en_passant_square()) &&
+              (board.submit_move(Square(from), to).status == MOVE_PLAYED))
+            mismatched++;
+        }
+      }
+
+      Move move = submittable[next_random(random) % submittable.size()];
+      MoveResult result = board.submit_move(Square(move_from(move)), Square(move_to(move)));
+      Snapshot snapshot;
+
+      if (move_flag(move) == PROMOTION)
+        promotions++;
+      if (move_flag(move) == EN_PASSANT)
+        en_passant++;
+      board.save_snapshot(snapshot);
+      if ((result.move != move) || (resumed.load_snapshot(snapshot) != FEN_OK) || (resumed.to_fen() != board.to_fen()) ||
+          (resumed.load_fen(board.to_fen()) != FEN_OK))
+        mismatched++;
+    }
+  }
+  return mismatched;
+}
+
+/* Run the snapshot command. Return the process exit status. */
+static int run_snapshot(int argc, char* argv[]) {
+  uint64_t game_count = 1000000;
+  string path;
+
+  for (int i = 2; i < argc; i++) {
+    string argument = argv[i];
+
+    if ((argument == "--games") && (i + 1 < argc))
+      game_count = strtoull(argv[++i], NULL, 10);
+    else
+      path = argument;
+  }
+
+  // games in progress, each a few random moves from the start
+  Position start_position;
+  start_position.set_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+  vector<Position> games(game_count, start_position);
+  Key random = 0x9E3779B97F4A7C15ULL;
+
+  for (Position &game : games) {
+    for (int ply = next_random(random) % 40; ply > 0; ply--) {
+      MoveList moves;
+      Undo undo;
+
+      game.generate_legal_moves(moves);
+      if (moves.size() == 0)
+        break;
+      game.do_move(moves[next_random(random) % moves.size()], undo);
+    }
+  }
+
+  vector<Snapshot> snapshots(game_count);
+  auto start = chrono::steady_clock::now();
+
+  for (uint64_t i = 0; i < game_count; i++)
+    games[i].save_snapshot(snapshots[i]);
+  cout << game_count << " games saved in " << chrono::duration<double>(chrono::steady_clock::now() - start).count() << " s" << endl;
+
+  if (!path.empty()) {
+    start = chrono::steady_clock::now();
+    if (!write_checkpoint(path, snapshots.data(), snapshots.size())) {
+      cout << "Cannot write " << path << "!" << endl;
+      return 1;
+    }
+    cout << game_count * sizeof(Snapshot) / 1e6 << " MB written in " << chrono::duration<double>(chrono::steady_clock::now() - start).count() << " s" << endl;
+
+    start = chrono::steady_clock::now();
+    if (!read_checkpoint(path, snapshots) || (snapshots.size() != game_count)) {
+      cout << "Cannot read " << path << "!" << endl;
+      return 1;
+    }
+    cout << "read back in " << chrono::duration<double>(chrono::steady_clock::now() - start).count() << " s" << endl;
+  }
+
+  // resumed games must match the originals exactly
+  uint64_t mismatched = 0;
+  Position resumed;
+  start = chrono::steady_clock::now();
+
+  for (uint64_t i = 0; i < game_count; i++) {
+    if ((resumed.load_snapshot(snapshots[i]) != FEN_OK) || (resumed.hash() != games[i].hash()))
+      mismatched++;
+  }
+  cout << game_count << " games loaded in " << chrono::duration<double>(chrono::steady_clock::now() - start).count() << " s, "
+       << mismatched << " mismatched" << endl;
+
+  // games played move by move, promotions included, must resume after every move
+  uint64_t promotions;
+  uint64_t en_passant;
+  uint64_t unresumable = check_submitted_games(1000, promotions, en_passant) + check_pawn_submissions();
+  cout << "1000 submitted games with " << promotions << " promotions and " << en_passant << " en passant captures resumed after every move, "
+       << unresumable << " mismatched" << endl;
+  return ((mismatched == 0) && (unresumable == 0) && (promotions > 0) && (en_passant > 0)) ? 0 : 1;
+}
+
+/* Run the serve command. Return the process exit status. */
+static int run_serve(int argc, char* argv[]) {
+  int shard_count = 4;
+  int client_count = 2;
+  int games_per_client = 256;
+  double seconds = 2;
+  string log_path;
+  EventLog::Format log_format = EventLog::TEXT;
+
+  for (int i = 2; i + 1 < argc; i += 2) {
+    string argument = argv[i];
+
+    if (argument == "--log")
+      log_path = argv[i + 1];
+    else if (argument == "--binary-log") {
+      log_path = argv[i + 1];
+      log_format = EventLog::BINARY;
+    }
+    else if (argument == "--shards")
+      shard_count = atoi(argv[i + 1]);
+    else if (argument == "--clients")
+      client_count = atoi(argv[i + 1]);
+    else if (argument == "--games")
+      games_per_client = atoi(argv[i + 1]);
+    else if (argument == "--seconds")
+      seconds = atof(argv[i + 1]);
+  }
+
+  ofstream log_file;
+  unique_ptr<EventLog> log;
+  if (!log_path.empty()) {
+    log_file.open(log_path, ios::binary | ios::trunc);
+    if (!log_file) {
+      cout << "Cannot write " << log_path << "!" << endl;
+      return 1;
+    }
+    log.reset(new EventLog(log_file, log_format));
+  }
+
+  SessionManager manager(shard_count, log.get());
+  LoadStats stats;
+
+  run_load(manager, client_count, games_per_client, seconds, stats);
+  manager.drain();
+
+  LatencyHistogram total;
+  for (int i = 0; i < manager.shard_count(); i++) {
+    cout << "shard " << i << ": " << manager.live_games(i) << " games live, " << manager.pooled_boards(i) << " boards pooled, ";
+    print_latency(cout, manager.latency(i));
+    total.add(manager.latency(i));
+  }
+
+  cout << "total: ";
+  print_latency(cout, total);
+  cout << stats.moves << " moves in " << stats.games << " games, " << stats.rejected << " rejected, in " << stats.seconds << " s ("
+       << stats.requests / stats.seconds << " requests/s)" << endl;
+  if (!log)
+    return (stats.rejected == 0) ? 0 : 1;
+
+  // every new game and move is either written or counted as dropped
+  log->close();
+  EventLogStats logged = log->stats();
+  uint64_t events = stats.games + stats.moves;
+
+  cout << "log: " << logged.written << " events written, " << logged.dropped << " dropped in " << logged.overflows << " overflows";
+  if (logged.written + logged.dropped != events)
+    cout << ", " << events << " expected";
+  cout << endl;
+  return ((stats.rejected == 0) && (logged.written + logged.dropped == events)) ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+  if ((argc >= 2) && (string(argv[1]) == "perft"))
+    return run_perft(argc, argv);
+
+  if ((argc >= 2) && (string(argv[1]) == "search"))
+    return run_search(argc, argv);
+
+  if ((argc >= 2) && (string(argv[1]) == "pgn"))
+    return run_pgn(argc, argv);
+
+  if ((argc >= 2) && (string(argv[1]) == "db"))
+    return run_db(argc, argv);
+
+  if ((argc >= 2) && (string(argv[1]) == "snapshot"))
+    return run_snapshot(argc, argv);
+
+  if ((argc >= 2) && (string(argv[1]) == "serve"))
+    return run_serve(argc, argv);
+
+  if (argc >= 2) {
+    print_usage();
+    return 1;
+  }
 
-int main() {
   cout << "===========================" << endl;
   cout << "Testing the Chess Engine" << endl;
   cout << "===========================" << endl;
@@ -0,0 +1,82 @@
+#include"Evaluation.h"
+
+
+/* Square bonuses for White pieces, rank 1 first. Black uses the same
+   tables mirrored vertically. */
+static const int square_bonus[6][64] = {
+  // Pawn
+  {  0,   0,   0,   0,   0,   0,   0,   0,
+     5,  10,  10, -20, -20,  10,  10,   5,
+     5,  -5, -10,   0,   0, -10,  -5,   5,
+     0,   0,   0,  20,  20,   0,   0,   0,
+     5,   5,  10,  25,  25,  10,   5,   5,
+    10,  10,  20,  30,  30,  20,  10,  10,
+    50,  50,  50,  50,  50,  50,  50,  50,
+     0,   0,   0,   0,   0,   0,   0,   0},
+  // Knight
+  {-50, -40, -30, -30, -30, -30, -40, -50,
+   -40, -20,   0,   5,   5,   0, -20, -40,
+   -30,   5,  10,  15,  15,  10,   5, -30,
+   -30,   0,  15,  20,  20,  15,   0, -30,
+   -30,   5,  15,  20,  20,  15,   5, -30,
+   -30,   0,  10,  15,  15,  10,   0, -30,
+   -40, -20,   0,   0,   0,   0, -20, -40,
+   -50, -40, -30, -30, -30, -30, -40, -50},
+  // Bishop
+  {-20, -10, -10, -10, -10, -10, -10, -20,
+   -10,   5,   0,   0,   0,   0,   5, -10,
+   -10,  10,  10,  10,  10,  10,  10, -10,
+   -10,   0,  10,  10,  10,  10,   0, -10,
+   -10,   5,   5,  10,  10,   5,   5, -10,
+   -10,   0,   5,  10,  10,   5,   0, -10,
+   -10,   0,   0,   0,   0,   0,   0, -10,
+   -20, -10, -10, -10, -10, -10, -10, -20},
+  // Castle
+  {  0,   0,   0,   5,   5,   0,   0,   0,
+    -5,   0,   0,   0,   0,   0,   0,  -5,
+    -5,   0,   0,   0,   0,   0,   0,  -5,
+    -5,   0,   0,   0,   0,   0,   0,  -5,
+    -5,   0,   0,   0,   0,   0,   0,  -5,
+    -5,   0,   0,   0,   0,   0,   0,  -5,
+     5,  10,  10,  10,  10,  10,  10,   5,
+     0,   0,   0,   0,   0,   0,   0,   0},
+  // Queen
+  {-20, -10, -10,  -5,  -5, -10, -10, -20,
+   -10,   0,   5,   0,   0,   0,   0, -10,
+   -10,   5,   5,   5,   5,   5,   0, -10,
+     0,   0,   5,   5,   5,   5,   0,  -5,
+    -5,   0,   5,   5,   5,   5,   0,  -5,
+   -10,   0,   5,   5,   5,   5,   0, -10,
+   -10,   0,   0,   0,   0,   0,   0, -10,
+   -20, -10, -10,  -5,  -5, -10, -10, -20},
+  // King
+  { 20,  30,  10,   0,   0,  10,  30,  20,
+    20,  20,   0,   0,   0,   0,  20,  20,
+   -10, -20, -20, -20, -20, -20, -20, -10,
+   -20, -30, -30, -40, -40, -30, -30, -20,
+   -30, -40, -40, -50, -50, -40, -40, -30,
+   -30, -40, -40, -50, -50, -40, -40, -30,
+   -30, -40, -40, -50, -50, -40, -40, -30,
+   -30, -40, -40, -50, -50, -40, -40, -30},
+};
+
+
+/* -------------------- Evaluation -------------------- */
+int evaluate(const Position &position) {
+  int score[2] = {0, 0};
+
+  for (int colour = WHITE; colour <= BLACK; colour++) {
+    // Black reads the tables upside down
+    int flip = (colour == WHITE) ? 0 : 56;
+
+    for (int type = PAWN; type <= KING; type++) {
+      for (Bitboard b = position.pieces(colour, type); b; ) {
+        int square = pop_lsb(b);
+        score[colour] += piece_values[type] + square_bonus[type][square ^ flip];
+      }
+    }
+  }
+
+  int us = position.side();
+  return score[us] - score[us ^ 1];
+}
@@ -0,0 +1,12 @@
+#ifndef EVALUATION_H
+#define EVALUATION_H
+
+#include"Position.h"
+
+/* Material value of each piece type in centipawns */
+const int piece_values[6] = {100, 320, 330, 500, 900, 0};
+
+/* Return the static score of position in centipawns, from the side to move's point of view */
+int evaluate(const Position &position);
+
+#endif
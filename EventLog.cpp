@@ -0,0 +1,199 @@
+#include<chrono>
+#include<sstream>
+#include<string>
+
+using namespace std;
+
+#include"EventLog.h"
+#include"ChessBoard.h"
+
+
+/* Source of EventLog ids; 0 is never used */
+static atomic<uint64_t> next_log_id(1);
+
+/* The ring the calling thread last used, and the log it belongs to. Ids are never reused,
+   so a cache left pointing into a destroyed log is simply never matched again. */
+struct RingCache {
+  uint64_t log_id;
+  void* ring;
+};
+static thread_local RingCache ring_cache = {0, NULL};
+
+
+/* -------------------- Ring -------------------- */
+EventLog::Ring::Ring(thread::id owner, uint64_t capacity) : owner(owner), slots(new EventRecord[capacity]), mask(capacity - 1), head(0), full(false), dropped(0), overflows(0), tail(0) {}
+
+
+/* -------------------- EventLog -------------------- */
+/* -------------------- Constructor -------------------- */
+EventLog::EventLog(ostream &out, Format format, int ring_capacity)
+  : out(out), format(format), ring_capacity(2), id(next_log_id++), written(0), stopping(false) {
+  while (this->ring_capacity < static_cast<uint64_t>(ring_capacity))
+    this->ring_capacity *= 2;
+
+  writer = thread(&EventLog::run, this);
+}
+
+EventLog::~EventLog() {
+  close();
+}
+
+/* -------------------- Events -------------------- */
+bool EventLog::new_game(uint32_t game) {
+  EventRecord record = EventRecord();
+
+  record.game = game;
+  record.type = EVENT_NEW_GAME;
+  return push(record);
+}
+
+bool EventLog::move(uint32_t game, int ply, const MoveResult &result) {
+  EventRecord record = EventRecord();
+
+  record.game = game;
+  record.ply = static_cast<uint16_t>(ply);
+  record.move = result.move;
+  record.type = EVENT_MOVE;
+  record.status = static_cast<uint8_t>(result.status);
+  record.from = static_cast<uint8_t>(static_cast<int>(result.from));
+  record.to = static_cast<uint8_t>(static_cast<int>(result.to));
+  record.moved = result.moved;
+  record.captured = result.captured;
+  record.flags = (result.check ? 1 : 0) | (result.checkmate ? 2 : 0) | (result.stalemate ? 4 : 0);
+  return push(record);
+}
+
+/* -------------------- Helpers -------------------- */
+EventLog::Ring& EventLog::thread_ring() {
+  if (ring_cache.log_id == id)
+    return *static_cast<Ring*>(ring_cache.ring);
+
+  // first event from this thread, or the thread last logged elsewhere
+  thread::id self = this_thread::get_id();
+  Ring* ring = NULL;
+  lock_guard<mutex> guard(rings_lock);
+
+  for (unique_ptr<Ring> &entry : rings) {
+    if (entry->owner == self)
+      ring = entry.get();
+  }
+
+  if (ring == NULL) {
+    rings.emplace_back(new Ring(self, ring_capacity));
+    ring = rings.back().get();
+  }
+
+  ring_cache.log_id = id;
+  ring_cache.ring = ring;
+  return *ring;
+}
+
+bool EventLog::push(const EventRecord &record) {
+  Ring &ring = thread_ring();
+  uint64_t head = ring.head.load(memory_order_relaxed);
+
+  // never wait for the writer: count the loss instead
+  if (head - ring.tail.load(memory_order_acquire) > ring.mask) {
+    if (!ring.full)
+      ring.overflows.store(ring.overflows.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    ring.full = true;
+    ring.dropped.store(ring.dropped.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    return false;
+  }
+
+  ring.full = false;
+  ring.slots[head & ring.mask] = record;
+  ring.head.store(head + 1, memory_order_release);
+  return true;
+}
+
+uint64_t EventLog::drain() {
+  vector<Ring*> current;
+  uint64_t count = 0;
+
+  {
+    lock_guard<mutex> guard(rings_lock);
+    for (unique_ptr<Ring> &ring : rings)
+      current.push_back(ring.get());
+  }
+
+  for (Ring* ring : current) {
+    uint64_t tail = ring->tail.load(memory_order_relaxed);
+    uint64_t head = ring->head.load(memory_order_acquire);
+
+    for (uint64_t i = tail; i < head; i++)
+      write(ring->slots[i & ring->mask]);
+
+    ring->tail.store(head, memory_order_release);
+    count += head - tail;
+  }
+
+  written.fetch_add(count, memory_order_relaxed);
+  return count;
+}
+
+void EventLog::write(const EventRecord &record) {
+  if (format == BINARY) {
+    out.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    return;
+  }
+
+  if (record.type == EVENT_NEW_GAME) {
+    out << "game " << record.game << ": A new chess game is started!\n";
+    return;
+  }
+
+  MoveResult result;
+  result.status = static_cast<MoveStatus>(record.status);
+  result.from = Square(record.from);
+  result.to = Square(record.to);
+  result.move = record.move;
+  result.moved = record.moved;
+  result.captured = record.captured;
+  result.check = (record.flags & 1) != 0;
+  result.checkmate = (record.flags & 2) != 0;
+  result.stalemate = (record.flags & 4) != 0;
+
+  // the formatter may print several lines; each is tagged with the game and ply
+  static thread_local ostringstream message;
+  message.str("");
+  print_move_result(message, result);
+
+  istringstream lines(message.str());
+  string line;
+  while (getline(lines, line))
+    out << "game " << record.game << " ply " << record.ply << ": " << line << "\n";
+}
+
+void EventLog::run() {
+  while (!stopping.load(memory_order_acquire)) {
+    if (drain() == 0) {
+      out.flush();
+      this_thread::sleep_for(chrono::milliseconds(1));
+    }
+  }
+
+  // events pushed before the log was destroyed are still written
+  drain();
+  out.flush();
+}
+
+void EventLog::close() {
+  if (!writer.joinable())
+    return;
+
+  stopping = true;
+  writer.join();
+}
+
+/* -------------------- Statistics -------------------- */
+EventLogStats EventLog::stats() {
+  EventLogStats result = {written.load(memory_order_relaxed), 0, 0};
+  lock_guard<mutex> guard(rings_lock);
+
+  for (unique_ptr<Ring> &ring : rings) {
+    result.dropped += ring->dropped.load(memory_order_relaxed);
+    result.overflows += ring->overflows.load(memory_order_relaxed);
+  }
+  return result;
+}
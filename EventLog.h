@@ -0,0 +1,124 @@
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include<atomic>
+#include<cstdint>
+#include<memory>
+#include<mutex>
+#include<ostream>
+#include<thread>
+#include<vector>
+
+struct MoveResult;
+
+/* Kinds of game event */
+enum EventType { EVENT_NEW_GAME, EVENT_MOVE };
+
+/* A game event packed into 16 bytes, as written in binary logs */
+struct EventRecord {
+  uint32_t game;
+  /* Moves played in the game before this event */
+  uint16_t ply;
+  uint16_t move;
+  uint8_t type;
+  /* MoveResult fields, for EVENT_MOVE */
+  uint8_t status;
+  uint8_t from;
+  uint8_t to;
+  uint8_t moved;
+  uint8_t captured;
+  /* Bit 0 check, bit 1 checkmate, bit 2 stalemate */
+  uint8_t flags;
+  uint8_t unused;
+};
+
+static_assert(sizeof(EventRecord) == 16, "EventRecord must stay 16 bytes");
+
+/* Event log counters */
+struct EventLogStats {
+  uint64_t written;
+  /* Events lost because their thread's buffer was full */
+  uint64_t dropped;
+  /* Times a buffer filled up */
+  uint64_t overflows;
+};
+
+/* Collects game events from any number of threads without blocking them.
+   Each producing thread gets its own single-producer ring buffer; a
+   background writer thread drains every ring to the output stream. When a
+   ring is full the event is dropped and counted rather than waited on. */
+class EventLog {
+public:
+  enum Format { TEXT, BINARY };
+
+private:
+  struct Ring {
+    /* The thread pushing onto the ring */
+    std::thread::id owner;
+    std::unique_ptr<EventRecord[]> slots;
+    uint64_t mask;
+    /* Written only by the producing thread */
+    alignas(64) std::atomic<uint64_t> head;
+    bool full;
+    std::atomic<uint64_t> dropped;
+    std::atomic<uint64_t> overflows;
+    /* Written only by the writer thread */
+    alignas(64) std::atomic<uint64_t> tail;
+
+    Ring(std::thread::id owner, uint64_t capacity);
+  };
+
+  std::ostream &out;
+  Format format;
+  uint64_t ring_capacity;
+  /* Distinguishes this log from any earlier one at the same address */
+  uint64_t id;
+
+  std::mutex rings_lock;
+  std::vector<std::unique_ptr<Ring>> rings;
+  std::atomic<uint64_t> written;
+  std::atomic<bool> stopping;
+  std::thread writer;
+
+  /* Return the calling thread's ring, creating it on first use. Threads only cache the ring they
+     used last, so nothing is left behind in them once the log is destroyed. */
+  Ring& thread_ring();
+
+  /* Add an event to the calling thread's ring. Return false if it was dropped. */
+  bool push(const EventRecord &record);
+
+  /* Write out every event waiting in the rings. Return the number written. */
+  uint64_t drain();
+
+  /* Write one event in the log's format */
+  void write(const EventRecord &record);
+
+  /* Drain the rings until the log is destroyed */
+  void run();
+
+public:
+  /* -------------------- Constructors -------------------- */
+  /* Log to out, giving each producing thread a ring of ring_capacity events (rounded up to a power of two) */
+  EventLog(std::ostream &out, Format format = TEXT, int ring_capacity = 4096);
+
+  /* Close the log */
+  ~EventLog();
+  EventLog(const EventLog&) = delete;
+  EventLog& operator=(const EventLog&) = delete;
+
+  /* -------------------- Events -------------------- */
+  /* Record the start of game. Return false if the event was dropped. */
+  bool new_game(uint32_t game);
+
+  /* Record a submitted move of game, ply moves in. Return false if the event was dropped. */
+  bool move(uint32_t game, int ply, const MoveResult &result);
+
+  /* Write out every event still buffered and stop the writer thread, so stats are final.
+     No events may be recorded once the log is closed. */
+  void close();
+
+  /* -------------------- Statistics -------------------- */
+  EventLogStats stats();
+};
+
+#endif
@@ -0,0 +1,217 @@
+#include<cstring>
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unistd.h>
+
+using namespace std;
+
+#include"GameDatabase.h"
+#include"ChessBoard.h"
+
+
+/* Identifies database files, and the version of the layout they use */
+static const char database_magic[8] = {'C', 'H', 'E', 'S', 'S', 'D', 'B', '\0'};
+static const uint32_t database_version = 1;
+
+/* Return length rounded up to a multiple of 8 */
+static uint64_t align8(uint64_t length) {
+  return (length + 7) & ~static_cast<uint64_t>(7);
+}
+
+/* Return true if header starts a database of length bytes with its index inside */
+static bool valid_header(const DatabaseHeader &header, uint64_t length) {
+  return (memcmp(header.magic, database_magic, sizeof(header.magic)) == 0) && (header.version == database_version) &&
+         (header.index_offset >= sizeof(header)) && (header.index_offset % 8 == 0) && (header.index_offset <= length) &&
+         (header.game_count <= (length - header.index_offset) / sizeof(uint64_t));
+}
+
+
+/* -------------------- GameDatabaseWriter -------------------- */
+/* -------------------- Constructors -------------------- */
+GameDatabaseWriter::GameDatabaseWriter() : offset(0) {}
+
+bool GameDatabaseWriter::open(const string &path) {
+  DatabaseHeader header = DatabaseHeader();
+
+  out.open(path, ios::binary | ios::out | ios::trunc);
+  offsets.clear();
+  offset = 0;
+
+  // the header is written again with the real counts by close
+  write(&header, sizeof(header));
+  return out.good();
+}
+
+bool GameDatabaseWriter::append(const string &path) {
+  DatabaseHeader header;
+
+  out.open(path, ios::binary | ios::in | ios::out);
+  offsets.clear();
+  offset = 0;
+
+  if (!out.read(reinterpret_cast<char*>(&header), sizeof(header)))
+    return false;
+
+  out.seekg(0, ios::end);
+  streamoff end = out.tellg();
+
+  if ((end < 0) || !valid_header(header, end)) {
+    out.close();
+    return false;
+  }
+
+  offsets.resize(header.game_count);
+  out.seekg(header.index_offset);
+  if (!offsets.empty() && !out.read(reinterpret_cast<char*>(offsets.data()), offsets.size() * sizeof(uint64_t))) {
+    out.close();
+    return false;
+  }
+
+  // new records start on the next record boundary after everything already there
+  const char padding[8] = {0};
+  out.seekp(end);
+  offset = end;
+  write(padding, align8(offset) - offset);
+  return out.good();
+}
+
+bool GameDatabaseWriter::close() {
+  DatabaseHeader header = DatabaseHeader();
+
+  memcpy(header.magic, database_magic, sizeof(header.magic));
+  header.version = database_version;
+  header.game_count = offsets.size();
+  header.index_offset = offset;
+
+  if (!offsets.empty())
+    write(offsets.data(), offsets.size() * sizeof(uint64_t));
+  out.seekp(0);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.close();
+  return !out.fail();
+}
+
+/* -------------------- Games -------------------- */
+void GameDatabaseWriter::add_game(const Move moves[], int plies, GameResult result, string_view fen) {
+  GameRecord record = GameRecord();
+  const char padding[8] = {0};
+
+  record.plies = plies;
+  record.result = static_cast<uint8_t>(result);
+  record.fen_length = static_cast<uint16_t>(min<size_t>(fen.size(), 0xFFFF));
+
+  offsets.push_back(offset);
+  write(&record, sizeof(record));
+  write(fen.data(), record.fen_length);
+  write(padding, record.fen_length & 1);
+  write(moves, plies * sizeof(Move));
+  write(padding, align8(offset) - offset);
+}
+
+/* -------------------- Helpers -------------------- */
+void GameDatabaseWriter::write(const void* data, size_t length) {
+  out.write(static_cast<const char*>(data), length);
+  offset += length;
+}
+
+
+/* -------------------- GameDatabase -------------------- */
+/* -------------------- Constructors -------------------- */
+GameDatabase::GameDatabase() : data(NULL), length(0), game_count(0), index(NULL) {}
+
+GameDatabase::~GameDatabase() {
+  close();
+}
+
+bool GameDatabase::open(const string &path) {
+  struct stat status;
+  int file = ::open(path.c_str(), O_RDONLY);
+
+  close();
+  if (file < 0)
+    return false;
+
+  if ((fstat(file, &status) == 0) && (status.st_size >= static_cast<off_t>(sizeof(DatabaseHeader)))) {
+    void* mapped = mmap(NULL, status.st_size, PROT_READ, MAP_SHARED, file, 0);
+
+    if (mapped != MAP_FAILED) {
+      data = static_cast<const char*>(mapped);
+      length = status.st_size;
+    }
+  }
+  ::close(file);
+
+  if (data == NULL)
+    return false;
+
+  DatabaseHeader header;
+  memcpy(&header, data, sizeof(header));
+
+  if (!valid_header(header, length)) {
+    close();
+    return false;
+  }
+
+  game_count = header.game_count;
+  index = reinterpret_cast<const uint64_t*>(data + header.index_offset);
+  return true;
+}
+
+void GameDatabase::close() {
+  if (data != NULL)
+    munmap(const_cast<char*>(data), length);
+
+  data = NULL;
+  length = 0;
+  game_count = 0;
+  index = NULL;
+}
+
+/* -------------------- Games -------------------- */
+bool GameDatabase::game(uint64_t number, StoredGame &game) const {
+  if (number >= game_count)
+    return false;
+
+  uint64_t offset = index[number];
+  uint64_t end = reinterpret_cast<const char*>(index) - data;
+  GameRecord record;
+
+  // bounds are checked by subtracting from end, which cannot wrap as adding to an offset read from the file can
+  if ((offset % 8 != 0) || (offset < sizeof(DatabaseHeader)) || (end < sizeof(record)) || (offset > end - sizeof(record)))
+    return false;
+  memcpy(&record, data + offset, sizeof(record));
+
+  // the FEN is padded so the moves start on an even offset
+  uint64_t fen_bytes = record.fen_length + (record.fen_length & 1);
+  if (fen_bytes > end - offset - sizeof(record))
+    return false;
+  uint64_t moves = offset + sizeof(record) + fen_bytes;
+  if (static_cast<uint64_t>(record.plies) * sizeof(Move) > end - moves)
+    return false;
+
+  game.result = static_cast<GameResult>(record.result);
+  game.fen = string_view(data + offset + sizeof(record), record.fen_length);
+  game.moves = reinterpret_cast<const Move*>(data + moves);
+  game.plies = static_cast<int>(record.plies);
+  return true;
+}
+
+bool GameDatabase::replay(uint64_t number, ChessBoard &board) const {
+  StoredGame stored;
+
+  if (!game(number, stored))
+    return false;
+
+  if (stored.fen.empty())
+    board.resetBoard(true);
+  else if (board.load_fen(stored.fen) != FEN_OK)
+    return false;
+
+  for (int i = 0; i < stored.plies; i++) {
+    if (!board.legal_move(stored.moves[i]))
+      return false;
+    board.make_move(stored.moves[i]);
+  }
+  return true;
+}
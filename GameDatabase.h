@@ -0,0 +1,121 @@
+#ifndef GAMEDATABASE_H
+#define GAMEDATABASE_H
+
+#include<cstdint>
+#include<fstream>
+#include<string>
+#include<string_view>
+#include<vector>
+
+#include"Move.h"
+#include"Pgn.h"
+
+class ChessBoard;
+
+/* Database files are laid out in host byte order as:
+   a DatabaseHeader; one record per game, each starting on an 8-byte
+   boundary; then the index, one 64-bit file offset per game record.
+   A record is a GameRecord, the FEN of the starting position if the game
+   does not start from the usual one, padded to an even length, and the
+   moves as 16-bit Moves. Games added later go after the old index, which
+   is left behind unused, so the file stays readable if adding is cut short. */
+
+/* Start of every database file */
+struct DatabaseHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t game_count;
+  /* Offset of the index of game records */
+  uint64_t index_offset;
+};
+
+static_assert(sizeof(DatabaseHeader) == 32, "DatabaseHeader is part of the file format");
+
+/* Start of every game record */
+struct GameRecord {
+  uint32_t plies;
+  /* A GameResult */
+  uint8_t result;
+  uint8_t reserved;
+  /* Length of the starting FEN, or 0 for the usual starting position */
+  uint16_t fen_length;
+};
+
+static_assert(sizeof(GameRecord) == 8, "GameRecord is part of the file format");
+
+/* A game read from a database, pointing into the mapped file */
+struct StoredGame {
+  GameResult result;
+  /* FEN of the starting position, or empty for the usual one */
+  std::string_view fen;
+  const Move* moves;
+  int plies;
+};
+
+/* Writes games to a new database file, or adds them to an existing one */
+class GameDatabaseWriter {
+private:
+  std::fstream out;
+  uint64_t offset;
+  std::vector<uint64_t> offsets;
+
+  /* Write length bytes of data at the end of the file */
+  void write(const void* data, size_t length);
+
+public:
+  /* -------------------- Constructors -------------------- */
+  GameDatabaseWriter();
+
+  /* Start a new database at path, replacing any file there. Return false if it cannot be created. */
+  bool open(const std::string &path);
+
+  /* Add games to the end of the database at path. Return false if it cannot be read or is not a database. */
+  bool append(const std::string &path);
+
+  /* Write the index and header. Return false if anything could not be written. */
+  bool close();
+
+  /* -------------------- Games -------------------- */
+  /* Add a game of plies legal moves from the position fen, or from the usual starting position if fen is empty */
+  void add_game(const Move moves[], int plies, GameResult result, std::string_view fen = std::string_view());
+
+  /* Return the number of games in the database */
+  uint64_t size() const { return offsets.size(); }
+};
+
+/* A database file mapped into memory. Games are read in place, without
+   parsing or allocating, either by number or one after another. */
+class GameDatabase {
+private:
+  const char* data;
+  size_t length;
+  uint64_t game_count;
+  const uint64_t* index;
+
+public:
+  /* -------------------- Constructors -------------------- */
+  GameDatabase();
+  ~GameDatabase();
+  GameDatabase(const GameDatabase&) = delete;
+  GameDatabase& operator=(const GameDatabase&) = delete;
+
+  /* Map the database at path. Return false if it cannot be read or is not a database. */
+  bool open(const std::string &path);
+
+  /* Unmap the database, if any */
+  void close();
+
+  /* -------------------- Games -------------------- */
+  /* Return the number of games */
+  uint64_t size() const { return game_count; }
+
+  /* Read game number (from 0) into game. Return false if there is no such game or its record is damaged. */
+  bool game(uint64_t number, StoredGame &game) const;
+
+  /* Replay game number into board without printing. The file may be damaged, so each move is checked
+     to be legal before it is played. Return false if the game cannot be read or a move is illegal. */
+  bool replay(uint64_t number, ChessBoard &board) const;
+};
+
+#endif
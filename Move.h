@@ -0,0 +1,70 @@
+#ifndef MOVE_H
+#define MOVE_H
+
+#include<cstdint>
+#include<string>
+
+/* A move packed into 16 bits:
+   bits 0-5 source square, bits 6-11 destination square,
+   bits 12-13 promotion piece (KNIGHT to QUEEN), bits 14-15 special move flag */
+typedef uint16_t Move;
+
+const Move NO_MOVE = 0;
+
+enum MoveFlag { NORMAL = 0, PROMOTION = 1, EN_PASSANT = 2, CASTLING = 3 };
+
+/* Return a move from from to to. Castling moves are stored as the king's move. */
+inline Move create_move(int from, int to, int flag = NORMAL, int promotion = 1) {
+  return static_cast<Move>(from | (to << 6) | ((promotion - 1) << 12) | (flag << 14));
+}
+
+/* Return the source square of a move */
+inline int move_from(Move move) {
+  return move & 0x3F;
+}
+
+/* Return the destination square of a move */
+inline int move_to(Move move) {
+  return (move >> 6) & 0x3F;
+}
+
+/* Return the special move flag of a move */
+inline int move_flag(Move move) {
+  return move >> 14;
+}
+
+/* Return the piece type a pawn promotes to, if the move is a promotion */
+inline int promotion_type(Move move) {
+  return ((move >> 12) & 3) + 1;
+}
+
+/* Return a move in coordinate notation, e.g. e2e4 or e7e8q */
+inline std::string move_to_uci(Move move) {
+  std::string text;
+
+  text += static_cast<char>('a' + (move_from(move) & 7));
+  text += static_cast<char>('1' + (move_from(move) >> 3));
+  text += static_cast<char>('a' + (move_to(move) & 7));
+  text += static_cast<char>('1' + (move_to(move) >> 3));
+  if (move_flag(move) == PROMOTION)
+    text += "nbrq"[promotion_type(move) - 1];
+  return text;
+}
+
+/* A fixed-capacity list of moves, large enough for any legal position */
+struct MoveList {
+  Move moves[256];
+  int count;
+
+  MoveList() : count(0) {}
+
+  void add(Move move) { moves[count++] = move; }
+  int size() const { return count; }
+  bool empty() const { return count == 0; }
+
+  Move operator[](int i) const { return moves[i]; }
+  const Move* begin() const { return moves; }
+  const Move* end() const { return moves + count; }
+};
+
+#endif
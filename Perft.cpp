@@ -0,0 +1,272 @@
+#include<iostream>
+#include<iomanip>
+#include<chrono>
+#include<vector>
+
+using namespace std;
+
+#include"Perft.h"
+#include"ThreadPool.h"
+
+
+/* A position with a published leaf count */
+struct PerftReference {
+  const char* name;
+  const char* fen;
+  int depth;
+  uint64_t nodes;
+};
+
+static const PerftReference references[] = {
+  {"Start position", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 6, 119060324},
+  {"Kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 5, 193690690},
+  {"Position 3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 6, 11030083},
+  {"Position 4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 5, 15833292},
+  {"Position 5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 5, 89941194},
+  {"Position 6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 5, 164075551},
+};
+
+/* Return the seconds elapsed since start */
+static double seconds_since(chrono::steady_clock::time_point start) {
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+/* Leaf nodes counted by one thread, padded to its own cache line */
+struct alignas(64) ThreadNodes {
+  uint64_t nodes = 0;
+};
+
+/* Count the leaf nodes below each of the root moves of position, two plies
+   down on threads workers, and add the nodes each worker counted to thread_nodes */
+static void parallel_count(const Position &position, int depth, int threads, int hash_megabytes,
+                           const MoveList &moves, vector<uint64_t> &root_counts, vector<ThreadNodes> &thread_nodes) {
+  unique_ptr<PerftHash> hash;
+  vector<atomic<uint64_t>> counts(moves.size());
+  ThreadPool pool(threads);
+
+  if (hash_megabytes > 0)
+    hash.reset(new PerftHash(hash_megabytes));
+  thread_nodes.assign(pool.size(), ThreadNodes());
+
+  // every reply to every root move is a separate task
+  for (int i = 0; i < moves.size(); i++) {
+    Position child = position;
+    MoveList replies;
+    Undo undo;
+
+    child.do_move(moves[i], undo);
+    child.generate_legal_moves(replies);
+
+    for (Move reply : replies) {
+      pool.submit([&, child, reply, i](int worker) {
+        Position grandchild = child;
+        Undo undo;
+
+        grandchild.do_move(reply, undo);
+        uint64_t nodes = hash ? perft(grandchild, depth - 2, *hash) : perft(grandchild, depth - 2);
+
+        counts[i] += nodes;
+        thread_nodes[worker].nodes += nodes;
+      });
+    }
+  }
+  pool.wait();
+
+  root_counts.assign(moves.size(), 0);
+  for (int i = 0; i < moves.size(); i++)
+    root_counts[i] = counts[i];
+}
+
+/* Print the node count, time and speed of a perft run */
+static void print_speed(uint64_t nodes, double seconds) {
+  cout << setiosflags(ios::fixed) << setprecision(3);
+  cout << "Nodes: " << nodes << endl;
+  cout << "Time: " << seconds << " s" << endl;
+  cout << "Speed: " << setprecision(2) << ((seconds > 0) ? nodes / seconds / 1e6 : 0.0) << " Mnodes/s" << endl;
+}
+
+
+/* -------------------- PerftHash -------------------- */
+/* -------------------- Constructor -------------------- */
+PerftHash::PerftHash(int megabytes) : mask(0) {
+  uint64_t count = 1;
+
+  while (count * 2 * sizeof(Entry) <= (static_cast<uint64_t>(megabytes) << 20))
+    count *= 2;
+
+  entries.reset(new Entry[count]());
+  mask = count - 1;
+}
+
+/* -------------------- Lookup -------------------- */
+bool PerftHash::probe(Key key, int depth, uint64_t &nodes) const {
+  const Entry &entry = entries[key & mask];
+  uint64_t data = entry.data.load(memory_order_relaxed);
+  uint64_t check = entry.check.load(memory_order_relaxed);
+
+  if (((check ^ data) != key) || ((data & 0xFF) != static_cast<uint64_t>(depth)))
+    return false;
+
+  nodes = data >> 8;
+  return true;
+}
+
+void PerftHash::store(Key key, int depth, uint64_t nodes) {
+  Entry &entry = entries[key & mask];
+  uint64_t data = (nodes << 8) | depth;
+
+  entry.data.store(data, memory_order_relaxed);
+  entry.check.store(key ^ data, memory_order_relaxed);
+}
+
+
+/* -------------------- Perft -------------------- */
+uint64_t perft(Position &position, int depth) {
+  MoveList moves;
+  uint64_t nodes = 0;
+  Undo undo;
+
+  if (depth == 0)
+    return 1;
+
+  position.generate_legal_moves(moves);
+
+  // the last ply only needs counting
+  if (depth == 1)
+    return moves.size();
+
+  for (Move move : moves) {
+    position.do_move(move, undo);
+    nodes += perft(position, depth - 1);
+    position.undo_move(move, undo);
+  }
+  return nodes;
+}
+
+uint64_t perft(Position &position, int depth, PerftHash &hash) {
+  MoveList moves;
+  uint64_t nodes = 0;
+  Undo undo;
+
+  // a single ply is cheaper to count than to look up
+  if (depth <= 1)
+    return perft(position, depth);
+
+  Key key = position.hash();
+  if (hash.probe(key, depth, nodes))
+    return nodes;
+
+  position.generate_legal_moves(moves);
+
+  for (Move move : moves) {
+    position.do_move(move, undo);
+    nodes += perft(position, depth - 1, hash);
+    position.undo_move(move, undo);
+  }
+
+  hash.store(key, depth, nodes);
+  return nodes;
+}
+
+uint64_t perft_divide(Position &position, int depth) {
+  MoveList moves;
+  uint64_t nodes = 0;
+  Undo undo;
+  auto start = chrono::steady_clock::now();
+
+  // the position itself is the only leaf with no plies to play
+  if (depth <= 0) {
+    print_speed(1, seconds_since(start));
+    return 1;
+  }
+
+  position.generate_legal_moves(moves);
+
+  for (Move move : moves) {
+    position.do_move(move, undo);
+    uint64_t count = (depth > 1) ? perft(position, depth - 1) : 1;
+    position.undo_move(move, undo);
+
+    cout << move_to_uci(move) << ": " << count << endl;
+    nodes += count;
+  }
+
+  cout << endl;
+  print_speed(nodes, seconds_since(start));
+  return nodes;
+}
+
+uint64_t parallel_perft_divide(const Position &position, int depth, int threads, int hash_megabytes) {
+  MoveList moves;
+  vector<uint64_t> root_counts;
+  vector<ThreadNodes> thread_nodes;
+  uint64_t nodes = 0;
+
+  // shallow trees have too little work to split
+  if (depth < 3) {
+    Position copy = position;
+    return perft_divide(copy, depth);
+  }
+
+  auto start = chrono::steady_clock::now();
+  position.generate_legal_moves(moves);
+  parallel_count(position, depth, threads, hash_megabytes, moves, root_counts, thread_nodes);
+  double seconds = seconds_since(start);
+
+  for (int i = 0; i < moves.size(); i++) {
+    cout << move_to_uci(moves[i]) << ": " << root_counts[i] << endl;
+    nodes += root_counts[i];
+  }
+
+  cout << endl;
+  for (int i = 0; i < static_cast<int>(thread_nodes.size()); i++)
+    cout << "Thread " << i << ": " << thread_nodes[i].nodes << " nodes" << endl;
+  print_speed(nodes, seconds);
+  return nodes;
+}
+
+bool perft_suite(int threads, int hash_megabytes) {
+  bool all_passed = true;
+  uint64_t total_nodes = 0;
+  auto suite_start = chrono::steady_clock::now();
+
+  for (const PerftReference &reference : references) {
+    Position position;
+    position.set_fen(reference.fen);
+
+    auto start = chrono::steady_clock::now();
+    uint64_t nodes = 0;
+
+    if ((threads > 1) || (hash_megabytes > 0)) {
+      MoveList moves;
+      vector<uint64_t> root_counts;
+      vector<ThreadNodes> thread_nodes;
+
+      position.generate_legal_moves(moves);
+      parallel_count(position, reference.depth, threads, hash_megabytes, moves, root_counts, thread_nodes);
+      for (uint64_t count : root_counts)
+        nodes += count;
+    }
+    else
+      nodes = perft(position, reference.depth);
+
+    double seconds = seconds_since(start);
+    bool passed = (nodes == reference.nodes);
+
+    cout << setiosflags(ios::left) << setw(16) << reference.name << resetiosflags(ios::left)
+         << " depth " << reference.depth << ": " << setw(10) << nodes
+         << (passed ? "  ok   " : "  FAIL ") << setiosflags(ios::fixed) << setprecision(2)
+         << setw(7) << ((seconds > 0) ? nodes / seconds / 1e6 : 0.0) << " Mnodes/s";
+    if (!passed)
+      cout << " (expected " << reference.nodes << ")";
+    cout << endl;
+
+    all_passed = all_passed && passed;
+    total_nodes += nodes;
+  }
+
+  cout << endl;
+  print_speed(total_nodes, seconds_since(suite_start));
+  cout << (all_passed ? "All perft counts match" : "Perft counts do not match") << endl;
+  return all_passed;
+}
@@ -0,0 +1,57 @@
+#ifndef PERFT_H
+#define PERFT_H
+
+#include<atomic>
+#include<cstdint>
+#include<memory>
+
+#include"Position.h"
+
+/* -------------------- Perft -------------------- */
+/* Move generation tests and benchmarks that count the leaf nodes of the
+   legal move tree. */
+
+/* Lock-free cache of leaf counts keyed by position and depth, shared by
+   all perft threads. Each entry is stored as (key ^ data, data) so a torn
+   write from a racing thread fails verification instead of being trusted. */
+class PerftHash {
+private:
+  struct Entry {
+    std::atomic<uint64_t> check;
+    std::atomic<uint64_t> data;
+  };
+
+  std::unique_ptr<Entry[]> entries;
+  uint64_t mask;
+
+public:
+  /* -------------------- Constructors -------------------- */
+  /* Use about megabytes of memory, rounded down to a power of two entries */
+  explicit PerftHash(int megabytes);
+
+  /* -------------------- Lookup -------------------- */
+  /* Return true and set nodes if the count for key at depth is cached */
+  bool probe(Key key, int depth, uint64_t &nodes) const;
+
+  /* Cache the count for key at depth, replacing whatever shares its slot */
+  void store(Key key, int depth, uint64_t nodes);
+};
+
+/* Return the number of leaf nodes depth moves below position */
+uint64_t perft(Position &position, int depth);
+
+/* As perft, caching subtree counts in hash */
+uint64_t perft(Position &position, int depth, PerftHash &hash);
+
+/* Print the leaf count below each legal move, the total and the speed. Return the total, which is 1 for depth 0. */
+uint64_t perft_divide(Position &position, int depth);
+
+/* As perft_divide, splitting the tree two plies down across threads that share a hash
+   of hash_megabytes (none if 0). Also prints the nodes counted by each thread. */
+uint64_t parallel_perft_divide(const Position &position, int depth, int threads, int hash_megabytes);
+
+/* Run perft on the reference positions and print each result and speed. Return true if all counts match.
+   With more than one thread or a hash, each position is counted as in parallel_perft_divide. */
+bool perft_suite(int threads = 1, int hash_megabytes = 0);
+
+#endif
@@ -0,0 +1,323 @@
+#include<cctype>
+#include<cstring>
+
+using namespace std;
+
+#include"Pgn.h"
+#include"ChessBoard.h"
+
+
+/* Copy the null-terminated text into out, which holds size characters, cutting it short if need be */
+static void copy_text(char out[], size_t size, const char text[]) {
+  size_t length = min(strlen(text), size - 1);
+
+  memcpy(out, text, length);
+  out[length] = '\0';
+}
+
+/* Read a game termination marker into result. Return false if text is not one. */
+static bool read_result(const char text[], GameResult &result) {
+  if (strcmp(text, "1-0") == 0)
+    result = RESULT_WHITE_WINS;
+  else if (strcmp(text, "0-1") == 0)
+    result = RESULT_BLACK_WINS;
+  else if (strcmp(text, "1/2-1/2") == 0)
+    result = RESULT_DRAW;
+  else if (strcmp(text, "*") == 0)
+    result = RESULT_UNKNOWN;
+  else
+    return false;
+  return true;
+}
+
+/* Return true if c ends a movetext token */
+static bool token_end(int c) {
+  return (c == EOF) || isspace(c) || (strchr("{}();[$", c) != NULL);
+}
+
+
+/* -------------------- PgnGame -------------------- */
+PgnGame::PgnGame() : number(0), line(0), status(PGN_OK), result(RESULT_UNKNOWN), plies(0), checkmate(false), stalemate(false) {
+  event[0] = '\0';
+  white[0] = '\0';
+  black[0] = '\0';
+  bad_move[0] = '\0';
+}
+
+const char* game_result_text(GameResult result) {
+  switch (result) {
+    case RESULT_WHITE_WINS: return "1-0";
+    case RESULT_BLACK_WINS: return "0-1";
+    case RESULT_DRAW: return "1/2-1/2";
+    case RESULT_UNKNOWN: break;
+  }
+  return "*";
+}
+
+void print_pgn_game(ostream &os, const PgnGame &game) {
+  os << "game " << game.number << " line " << game.line << ": " << (game.white[0] ? game.white : "?") << " - "
+     << (game.black[0] ? game.black : "?") << " " << game_result_text(game.result) << ", " << game.plies << " plies";
+
+  switch (game.status) {
+    case PGN_OK:
+      if (game.checkmate)
+        os << ", checkmate";
+      else if (game.stalemate)
+        os << ", stalemate";
+      break;
+    case PGN_BAD_FEN:
+      os << ", cannot read FEN";
+      break;
+    case PGN_ILLEGAL_MOVE:
+      os << ", illegal move " << game.bad_move << " at ply " << game.plies + 1;
+      break;
+    case PGN_WRONG_RESULT:
+      os << ", result does not match the game";
+      break;
+    case PGN_NO_RESULT:
+      os << ", no result";
+      break;
+  }
+  os << "\n";
+}
+
+
+/* -------------------- PgnReader -------------------- */
+/* -------------------- Constructors -------------------- */
+PgnReader::PgnReader(istream &in)
+  : in(&in), buffer(new char[BUFFER_SIZE]), next(NULL), end(NULL), line(1), last('\n'), games(0), tag_result(RESULT_UNKNOWN) {
+  fen[0] = '\0';
+}
+
+PgnReader::PgnReader(const char text[], size_t length)
+  : in(NULL), next(text), end(text + length), line(1), last('\n'), games(0), tag_result(RESULT_UNKNOWN) {
+  fen[0] = '\0';
+}
+
+/* -------------------- Games -------------------- */
+bool PgnReader::next_game(ChessBoard &board, PgnGame &game, vector<Move>* moves) {
+  // text between games is ignored
+  for (;;) {
+    skip_space();
+    int c = peek();
+
+    if (c == EOF)
+      return false;
+    if (c == '{')
+      skip_block('{', '}');
+    else if ((c == ';') || ((c == '%') && (last == '\n')))
+      skip_line();
+    else
+      break;
+  }
+
+  game = PgnGame();
+  game.number = ++games;
+  game.line = line;
+  tag_result = RESULT_UNKNOWN;
+  fen[0] = '\0';
+
+  while (peek() == '[') {
+    read_tag(game);
+    skip_space();
+  }
+
+  if (fen[0] == '\0')
+    board.resetBoard(true);
+  else if (board.load_fen(fen) != FEN_OK)
+    game.status = PGN_BAD_FEN;
+
+  if (moves)
+    moves->clear();
+  read_moves(board, game, moves);
+  return true;
+}
+
+void PgnReader::read_tag(PgnGame &game) {
+  char name[MAX_TOKEN];
+  char value[MAX_TOKEN];
+  int length = 0;
+  int c;
+
+  get();
+  skip_space();
+  while (!token_end(c = peek()) && (c != '"') && (c != ']')) {
+    if (length < MAX_TOKEN - 1)
+      name[length++] = static_cast<char>(c);
+    get();
+  }
+  name[length] = '\0';
+
+  skip_space();
+  length = 0;
+  if (peek() == '"') {
+    get();
+    while (((c = get()) != EOF) && (c != '"') && (c != '\n')) {
+      if (c == '\\')
+        c = get();
+      if ((c != EOF) && (length < MAX_TOKEN - 1))
+        value[length++] = static_cast<char>(c);
+    }
+  }
+  value[length] = '\0';
+
+  // the rest of the tag, up to its closing bracket
+  while (((c = peek()) != EOF) && (c != '\n')) {
+    get();
+    if (c == ']')
+      break;
+  }
+
+  if (strcmp(name, "Event") == 0)
+    copy_text(game.event, sizeof(game.event), value);
+  else if (strcmp(name, "White") == 0)
+    copy_text(game.white, sizeof(game.white), value);
+  else if (strcmp(name, "Black") == 0)
+    copy_text(game.black, sizeof(game.black), value);
+  else if (strcmp(name, "Result") == 0)
+    read_result(value, tag_result);
+  else if (strcmp(name, "FEN") == 0)
+    copy_text(fen, sizeof(fen), value);
+}
+
+void PgnReader::read_moves(ChessBoard &board, PgnGame &game, vector<Move>* moves) {
+  char token[MAX_TOKEN];
+  bool ended = false;
+
+  while (!ended) {
+    skip_space();
+    int c = peek();
+
+    // a tag starts the next game
+    if ((c == EOF) || (c == '['))
+      break;
+
+    if (c == '{') {
+      skip_block('{', '}');
+      continue;
+    }
+    if (c == '(') {
+      skip_block('(', ')');
+      continue;
+    }
+    if ((c == ';') || ((c == '%') && (last == '\n'))) {
+      skip_line();
+      continue;
+    }
+
+    read_token(token);
+    if ((token[0] == '$') || (token[0] == ')'))
+      continue;
+    if (read_result(token, game.result)) {
+      ended = true;
+      continue;
+    }
+
+    // move numbers, 12. or 12..., may run into the move that follows
+    const char* san = token;
+    if ((san[0] >= '1') && (san[0] <= '9')) {
+      while ((*san >= '0') && (*san <= '9'))
+        san++;
+      if (*san == '.') {
+        while (*san == '.')
+          san++;
+      }
+      else
+        san = token;
+    }
+
+    if ((*san == '\0') || (game.status != PGN_OK))
+      continue;
+
+    Move move = board.parse_san(san);
+
+    if (move == NO_MOVE) {
+      game.status = PGN_ILLEGAL_MOVE;
+      copy_text(game.bad_move, sizeof(game.bad_move), san);
+      continue;
+    }
+
+    board.make_move(move);
+    game.plies++;
+    if (moves)
+      moves->push_back(move);
+  }
+
+  if (!ended)
+    game.result = tag_result;
+  if (game.status != PGN_OK)
+    return;
+
+  // only the final position needs looking at
+  game.checkmate = board.check() && board.check_mate();
+  game.stalemate = board.stalemate();
+
+  if (!ended)
+    game.status = PGN_NO_RESULT;
+  else if (game.result == RESULT_UNKNOWN)
+    return;
+  else if ((tag_result != RESULT_UNKNOWN) && (tag_result != game.result))
+    game.status = PGN_WRONG_RESULT;
+  else if (game.checkmate && (game.result != ((board.get_turn() == 'B') ? RESULT_WHITE_WINS : RESULT_BLACK_WINS)))
+    game.status = PGN_WRONG_RESULT;
+  else if (game.stalemate && (game.result != RESULT_DRAW))
+    game.status = PGN_WRONG_RESULT;
+}
+
+/* -------------------- Helpers -------------------- */
+bool PgnReader::refill() {
+  if ((in == NULL) || !*in)
+    return false;
+
+  in->read(buffer.get(), BUFFER_SIZE);
+  next = buffer.get();
+  end = next + in->gcount();
+  return next != end;
+}
+
+void PgnReader::skip_space() {
+  int c;
+
+  while (((c = peek()) != EOF) && isspace(c))
+    get();
+}
+
+void PgnReader::skip_line() {
+  int c;
+
+  while (((c = get()) != EOF) && (c != '\n'))
+    ;
+}
+
+void PgnReader::skip_block(char open, char close) {
+  int depth = 0;
+  int c;
+
+  while ((c = get()) != EOF) {
+    if (c == open)
+      depth++;
+    else if (c == close) {
+      if (--depth == 0)
+        return;
+    }
+    // comments inside a variation may hold brackets of their own
+    else if ((c == '{') && (open == '(')) {
+      while (((c = get()) != EOF) && (c != '}'))
+        ;
+    }
+  }
+}
+
+int PgnReader::read_token(char token[]) {
+  int length = 0;
+
+  do {
+    int c = get();
+
+    if (length < MAX_TOKEN - 1)
+      token[length++] = static_cast<char>(c);
+  } while (!token_end(peek()));
+
+  token[length] = '\0';
+  return length;
+}
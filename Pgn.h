@@ -0,0 +1,144 @@
+#ifndef PGN_H
+#define PGN_H
+
+#include<cstdint>
+#include<cstdio>
+#include<istream>
+#include<memory>
+#include<ostream>
+#include<vector>
+
+#include"Move.h"
+
+class ChessBoard;
+
+/* How a game's record checked out */
+enum PgnStatus {
+  PGN_OK,
+  /* The FEN tag cannot be read */
+  PGN_BAD_FEN,
+  /* A move is unreadable, ambiguous or illegal */
+  PGN_ILLEGAL_MOVE,
+  /* The result disagrees with the final position or the Result tag */
+  PGN_WRONG_RESULT,
+  /* The game ends without a result */
+  PGN_NO_RESULT
+};
+
+/* Game results as written in PGN */
+enum GameResult { RESULT_UNKNOWN, RESULT_WHITE_WINS, RESULT_BLACK_WINS, RESULT_DRAW };
+
+/* What was read and checked of one game. Fixed size: long tags are cut short. */
+struct PgnGame {
+  /* Position of the game in its input, from 1 */
+  uint64_t number;
+  /* Line of the input the game starts on, from 1 */
+  uint64_t line;
+  PgnStatus status;
+  GameResult result;
+  /* Moves replayed, up to the first illegal one */
+  int plies;
+  /* State of the final position */
+  bool checkmate;
+  bool stalemate;
+  char event[48];
+  char white[48];
+  char black[48];
+  /* The move that could not be played, if any */
+  char bad_move[16];
+
+  PgnGame();
+};
+
+/* Return the PGN text of result: 1-0, 0-1, 1/2-1/2 or * */
+const char* game_result_text(GameResult result);
+
+/* Print one line describing game */
+void print_pgn_game(std::ostream &os, const PgnGame &game);
+
+/* Reads games one at a time from PGN text, replaying the moves of each into
+   a ChessBoard to check them. Text is read through a fixed buffer and tags
+   and tokens are cut to fixed lengths, so memory use does not grow with the
+   size of the input or of any one game. Comments, variations, numeric
+   annotations and escaped lines are skipped. */
+class PgnReader {
+private:
+  /* Bytes read from the stream at a time */
+  static const int BUFFER_SIZE = 1 << 16;
+  /* Longest token or tag value kept; longer ones are cut short */
+  static const int MAX_TOKEN = 128;
+
+  std::istream* in;
+  std::unique_ptr<char[]> buffer;
+  const char* next;
+  const char* end;
+  uint64_t line;
+  /* The last character read */
+  int last;
+  uint64_t games;
+  /* The Result tag of the game being read */
+  GameResult tag_result;
+  /* The FEN tag of the game being read, if any */
+  char fen[MAX_TOKEN];
+
+  /* Refill the buffer from the stream. Return false at the end of the input. */
+  bool refill();
+
+  /* Return the next character without reading it, or EOF */
+  int peek() {
+    if ((next == end) && !refill())
+      return EOF;
+    return static_cast<unsigned char>(*next);
+  }
+
+  /* Read and return the next character, or EOF */
+  int get() {
+    int c = peek();
+
+    if (c == '\n')
+      line++;
+    if (c != EOF)
+      next++;
+    last = c;
+    return c;
+  }
+
+  /* Skip whitespace */
+  void skip_space();
+
+  /* Skip the rest of the line */
+  void skip_line();
+
+  /* Skip a comment or variation opened by open, up to its matching close */
+  void skip_block(char open, char close);
+
+  /* Read the next movetext token into token. Return its length. */
+  int read_token(char token[]);
+
+  /* Read a tag pair such as [White "Fischer, Robert J."], keeping the tags game needs */
+  void read_tag(PgnGame &game);
+
+  /* Read the movetext, replaying moves into board until the game ends, and adding them to moves if not NULL */
+  void read_moves(ChessBoard &board, PgnGame &game, std::vector<Move>* moves);
+
+public:
+  /* -------------------- Constructors -------------------- */
+  /* Read games from a stream */
+  explicit PgnReader(std::istream &in);
+
+  /* Read games from length bytes of text in memory, which must outlive the reader */
+  PgnReader(const char text[], size_t length);
+
+  PgnReader(const PgnReader&) = delete;
+  PgnReader& operator=(const PgnReader&) = delete;
+
+  /* -------------------- Games -------------------- */
+  /* Read the next game, replaying it into board without printing, and describe it in game.
+     The moves played are stored in moves if it is not NULL. Return false if there are no more games. */
+  bool next_game(ChessBoard &board, PgnGame &game, std::vector<Move>* moves = NULL);
+
+  /* Return the FEN tag of the last game read, or an empty string if it starts from the usual position */
+  const char* start_fen() const { return fen; }
+};
+
+#endif
@@ -0,0 +1,805 @@
+#include<cstdlib>
+#include<cctype>
+#include<cstring>
+#include<iostream>
+#include<algorithm>
+
+#include"Position.h"
+#include"Attacks.h"
+#include"Square.h"
+
+
+/* FEN letters of the pieces, White's then Black's, in piece type order */
+static const char fen_letters[] = "PNBRQKpnbrqk";
+
+/* Return the piece code of a FEN piece letter, or NO_PIECE */
+static int fen_piece(char letter) {
+  switch (letter) {
+    case 'P': return make_piece(WHITE, PAWN);
+    case 'N': return make_piece(WHITE, KNIGHT);
+    case 'B': return make_piece(WHITE, BISHOP);
+    case 'R': return make_piece(WHITE, CASTLE);
+    case 'Q': return make_piece(WHITE, QUEEN);
+    case 'K': return make_piece(WHITE, KING);
+    case 'p': return make_piece(BLACK, PAWN);
+    case 'n': return make_piece(BLACK, KNIGHT);
+    case 'b': return make_piece(BLACK, BISHOP);
+    case 'r': return make_piece(BLACK, CASTLE);
+    case 'q': return make_piece(BLACK, QUEEN);
+    case 'k': return make_piece(BLACK, KING);
+  }
+  return NO_PIECE;
+}
+
+/* FEN letters of the castling rights, in bit order */
+static const char castling_letters[] = "KQkq";
+
+/* Return the next space-separated field of text and remove it, or an empty field if none is left */
+static std::string_view next_field(std::string_view &text) {
+  size_t start = 0;
+  size_t end;
+
+  while ((start < text.size()) && isspace(static_cast<unsigned char>(text[start])))
+    start++;
+  for (end = start; (end < text.size()) && !isspace(static_cast<unsigned char>(text[end])); end++)
+    ;
+
+  std::string_view field = text.substr(start, end - start);
+  text.remove_prefix(end);
+  return field;
+}
+
+/* Read the decimal number in text into value. Return false if text is not a number from 0 to max. */
+static bool read_number(std::string_view text, int max, int &value) {
+  value = 0;
+
+  for (char c : text) {
+    if ((c < '0') || (c > '9'))
+      return false;
+    value = value * 10 + (c - '0');
+    if (value > max)
+      return false;
+  }
+  return true;
+}
+
+/* Write value in decimal at out and return the end of the digits */
+static char* write_number(char* out, int value) {
+  char digits[10];
+  int count = 0;
+
+  do {
+    digits[count++] = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while (value > 0);
+
+  while (count > 0)
+    *out++ = digits[--count];
+  return out;
+}
+
+/* Return the castling rights lost when a piece moves from or to square */
+static int rights_lost(int square) {
+  switch (square) {
+    case 0: return WHITE_QUEENSIDE;
+    case 4: return WHITE_KINGSIDE | WHITE_QUEENSIDE;
+    case 7: return WHITE_KINGSIDE;
+    case 56: return BLACK_QUEENSIDE;
+    case 60: return BLACK_KINGSIDE | BLACK_QUEENSIDE;
+    case 63: return BLACK_KINGSIDE;
+  }
+  return 0;
+}
+
+/* Return the squares a knight, bishop, castle or queen on square attacks */
+static Bitboard piece_attacks(int type, int square, Bitboard occupied) {
+  switch (type) {
+    case KNIGHT: return knight_attacks[square];
+    case BISHOP: return bishop_attacks(square, occupied);
+    case CASTLE: return castle_attacks(square, occupied);
+    case QUEEN: return queen_attacks(square, occupied);
+  }
+  return 0;
+}
+
+/* Return the check bits of a snapshot: the low bits of the key, which covers everything else, mixed with the move clocks */
+static uint16_t snapshot_check(Key key, int halfmove_clock, int fullmove_number) {
+  return static_cast<uint16_t>(key ^ (halfmove_clock << 8) ^ fullmove_number);
+}
+
+
+const char* fen_error_message(FenError error) {
+  switch (error) {
+    case FEN_OK: return "no error";
+    case FEN_BAD_FIELDS: return "expected piece placement, side to move, castling rights and en passant square, then optionally the two move clocks";
+    case FEN_BAD_PLACEMENT: return "piece placement must give 8 ranks of 8 squares using PNBRQK, pnbrqk and the digits 1 to 8";
+    case FEN_BAD_KINGS: return "each side must have exactly one king";
+    case FEN_BAD_PAWNS: return "pawns cannot stand on the first or last rank";
+    case FEN_BAD_SIDE: return "side to move must be w or b";
+    case FEN_BAD_CASTLING: return "castling rights must be - or some of KQkq, each with its king and castle on their starting squares";
+    case FEN_BAD_EN_PASSANT: return "en passant square must be - or the square a pawn has just passed over with a double step";
+    case FEN_BAD_CLOCKS: return "move clocks must be a halfmove count from 0 to 255 and a move number from 1 to 65535";
+    case FEN_OPPONENT_IN_CHECK: return "the side not to move is in check";
+    case FEN_BAD_SNAPSHOT: return "snapshot does not match its check bits";
+  }
+  return "unknown error";
+}
+
+
+/* -------------------- Position -------------------- */
+/* -------------------- Constructor -------------------- */
+Position::Position() {
+  clear();
+}
+
+void Position::clear() {
+  for (int type = PAWN; type <= KING; type++)
+    by_type[type] = 0;
+  by_colour[WHITE] = 0;
+  by_colour[BLACK] = 0;
+  king_squares[WHITE] = NO_SQUARE;
+  king_squares[BLACK] = NO_SQUARE;
+
+  // every nibble NO_PIECE
+  for (int i = 0; i < 32; i++)
+    board[i] = 0xFF;
+
+  side_to_move = WHITE;
+  castling_rights = ALL_CASTLING;
+  en_passant = NO_SQUARE;
+  halfmove_clock = 0;
+  fullmove_number = 1;
+  key = zobrist.castling[castling_rights];
+}
+
+FenError Position::load_fen(std::string_view fen) {
+  std::string_view placement = next_field(fen);
+  std::string_view side = next_field(fen);
+  std::string_view castling = next_field(fen);
+  std::string_view passant = next_field(fen);
+  std::string_view halfmoves = next_field(fen);
+  std::string_view fullmoves = next_field(fen);
+  Position result;
+  int rank = 7;
+  int file = 0;
+
+  if (passant.empty() || !next_field(fen).empty())
+    return FEN_BAD_FIELDS;
+
+  for (char c : placement) {
+    int piece = fen_piece(c);
+
+    if ((c == '/') && (file == 8) && (rank > 0)) {
+      rank--;
+      file = 0;
+    }
+    else if ((c >= '1') && (c <= '8') && (file + c - '0' <= 8))
+      file += c - '0';
+    else if ((piece != NO_PIECE) && (file < 8)) {
+      result.put_piece(piece, make_square(rank, file));
+      file++;
+    }
+    else
+      return FEN_BAD_PLACEMENT;
+  }
+  if ((rank != 0) || (file != 8))
+    return FEN_BAD_PLACEMENT;
+
+  FenError error = result.check_pieces();
+  if (error != FEN_OK)
+    return error;
+
+  if ((side != "w") && (side != "b"))
+    return FEN_BAD_SIDE;
+  result.side_to_move = (side == "b") ? BLACK : WHITE;
+
+  result.castling_rights = 0;
+  if (castling != "-") {
+    for (char c : castling) {
+      const char* letter = (c != '\0') ? strchr(castling_letters, c) : NULL;
+
+      if (!letter || (result.castling_rights & (1 << (letter - castling_letters))))
+        return FEN_BAD_CASTLING;
+      result.castling_rights |= 1 << (letter - castling_letters);
+    }
+  }
+  if (!result.valid_castling())
+    return FEN_BAD_CASTLING;
+
+  if (passant != "-") {
+    char name[3] = {passant[0], (passant.size() == 2) ? passant[1] : '\0', '\0'};
+    Square square = Square::parse(name);
+
+    if ((passant.size() != 2) || !square.valid() || !result.set_en_passant(square))
+      return FEN_BAD_EN_PASSANT;
+  }
+
+  // the move clocks are optional
+  int halfmove_clock = 0;
+  int fullmove_number = 1;
+  if ((!halfmoves.empty() && !read_number(halfmoves, 255, halfmove_clock)) ||
+      (!fullmoves.empty() && !read_number(fullmoves, 65535, fullmove_number)) || (fullmove_number == 0))
+    return FEN_BAD_CLOCKS;
+  result.halfmove_clock = static_cast<uint8_t>(halfmove_clock);
+  result.fullmove_number = static_cast<uint16_t>(fullmove_number);
+
+  if (result.opponent_in_check())
+    return FEN_OPPONENT_IN_CHECK;
+
+  result.finish_key();
+  *this = result;
+  return FEN_OK;
+}
+
+void Position::save_snapshot(Snapshot &snapshot) const {
+  memcpy(snapshot.board, board, sizeof(board));
+  snapshot.side_to_move = side_to_move;
+  snapshot.castling_rights = castling_rights;
+  snapshot.en_passant = en_passant;
+  snapshot.halfmove_clock = halfmove_clock;
+  snapshot.fullmove_number = fullmove_number;
+  snapshot.check = snapshot_check(key, halfmove_clock, fullmove_number);
+}
+
+FenError Position::load_snapshot(const Snapshot &snapshot) {
+  Position result;
+
+  // the board is packed as Position keeps it, so only the bitboards and key need building
+  memcpy(result.board, snapshot.board, sizeof(result.board));
+  for (int first = 0; first < 64; first += 16) {
+    uint64_t nibbles = 0;
+
+    for (int i = 7; i >= 0; i--)
+      nibbles = (nibbles << 8) | snapshot.board[(first >> 1) + i];
+
+    // visit only the squares with a piece, found without a branch per square: a nibble is NO_PIECE when all its bits are set
+    uint64_t occupied = ~(nibbles & (nibbles >> 1) & (nibbles >> 2) & (nibbles >> 3)) & 0x1111111111111111ULL;
+
+    while (occupied) {
+      int shift = pop_lsb(occupied);
+      int piece = (nibbles >> shift) & 15;
+      int square = first + (shift >> 2);
+
+      if (piece_type(piece) > KING)
+        return FEN_BAD_PLACEMENT;
+      result.by_type[piece_type(piece)] |= square_bb(square);
+      result.by_colour[piece_colour(piece)] |= square_bb(square);
+      result.key ^= zobrist.pieces[piece][square];
+    }
+  }
+
+  FenError error = result.check_pieces();
+  if (error != FEN_OK)
+    return error;
+  result.king_squares[WHITE] = static_cast<uint8_t>(lsb(result.pieces(WHITE, KING)));
+  result.king_squares[BLACK] = static_cast<uint8_t>(lsb(result.pieces(BLACK, KING)));
+
+  if (snapshot.side_to_move > BLACK)
+    return FEN_BAD_SIDE;
+  result.side_to_move = snapshot.side_to_move;
+
+  result.castling_rights = snapshot.castling_rights;
+  if ((snapshot.castling_rights > ALL_CASTLING) || !result.valid_castling())
+    return FEN_BAD_CASTLING;
+
+  if ((snapshot.en_passant != NO_SQUARE) && ((snapshot.en_passant > NO_SQUARE) || !result.set_en_passant(snapshot.en_passant)))
+    return FEN_BAD_EN_PASSANT;
+
+  if (snapshot.fullmove_number == 0)
+    return FEN_BAD_CLOCKS;
+  result.halfmove_clock = snapshot.halfmove_clock;
+  result.fullmove_number = snapshot.fullmove_number;
+
+  if (result.opponent_in_check())
+    return FEN_OPPONENT_IN_CHECK;
+
+  result.finish_key();
+  if (snapshot_check(result.key, result.halfmove_clock, result.fullmove_number) != snapshot.check)
+    return FEN_BAD_SNAPSHOT;
+
+#ifdef DEBUG_HASH
+  result.verify_key();
+#endif
+  *this = result;
+  return FEN_OK;
+}
+
+int Position::write_fen(char out[]) const {
+  char* end = out;
+
+  for (int rank = 7; rank >= 0; rank--) {
+    int empty = 0;
+
+    for (int file = 0; file < 8; file++) {
+      int piece = piece_on(make_square(rank, file));
+
+      if (piece == NO_PIECE) {
+        empty++;
+        continue;
+      }
+      if (empty > 0)
+        *end++ = static_cast<char>('0' + empty);
+      empty = 0;
+      *end++ = fen_letters[piece_colour(piece) * 6 + piece_type(piece)];
+    }
+
+    if (empty > 0)
+      *end++ = static_cast<char>('0' + empty);
+    if (rank > 0)
+      *end++ = '/';
+  }
+
+  *end++ = ' ';
+  *end++ = (side_to_move == WHITE) ? 'w' : 'b';
+  *end++ = ' ';
+
+  if (castling_rights == 0)
+    *end++ = '-';
+  for (int right = 0; right < 4; right++) {
+    if (castling_rights & (1 << right))
+      *end++ = castling_letters[right];
+  }
+
+  *end++ = ' ';
+  if (en_passant == NO_SQUARE)
+    *end++ = '-';
+  else {
+    *end++ = static_cast<char>('a' + square_file(en_passant));
+    *end++ = static_cast<char>('1' + square_rank(en_passant));
+  }
+
+  *end++ = ' ';
+  end = write_number(end, halfmove_clock);
+  *end++ = ' ';
+  end = write_number(end, fullmove_number);
+  *end = '\0';
+
+  return static_cast<int>(end - out);
+}
+
+std::string Position::fen() const {
+  char text[MAX_FEN_LENGTH];
+  int length = write_fen(text);
+
+  return std::string(text, length);
+}
+
+/* -------------------- Board updates -------------------- */
+void Position::put_piece(int piece, int square) {
+  Bitboard b = square_bb(square);
+
+  by_type[piece_type(piece)] |= b;
+  by_colour[piece_colour(piece)] |= b;
+  set_board(square, piece);
+  if (piece_type(piece) == KING)
+    king_squares[piece_colour(piece)] = static_cast<uint8_t>(square);
+  key ^= zobrist.pieces[piece][square];
+}
+
+int Position::remove_piece(int square) {
+  int piece = piece_on(square);
+  Bitboard b = square_bb(square);
+
+  by_type[piece_type(piece)] ^= b;
+  by_colour[piece_colour(piece)] ^= b;
+  set_board(square, NO_PIECE);
+  key ^= zobrist.pieces[piece][square];
+
+  return piece;
+}
+
+int Position::move_piece(int from, int to) {
+  int taken = NO_PIECE;
+
+  if (piece_on(to) != NO_PIECE)
+    taken = remove_piece(to);
+
+  put_piece(remove_piece(from), to);
+  return taken;
+}
+
+void Position::do_move(Move move, Undo &undo) {
+  int from = move_from(move);
+  int to = move_to(move);
+  int us = side_to_move;
+  int moving_type = piece_type(piece_on(from));
+
+  undo.key = key;
+  undo.captured = piece_on(to);
+  undo.castling_rights = castling_rights;
+  undo.en_passant = en_passant;
+  undo.halfmove_clock = halfmove_clock;
+
+  if (move_flag(move) == CASTLING) {
+    // the castle jumps to the square the king passes over
+    if (to > from)
+      move_piece(from + 3, from + 1);
+    else
+      move_piece(from - 4, from - 1);
+  }
+  else if (move_flag(move) == EN_PASSANT)
+    undo.captured = remove_piece(to + ((us == WHITE) ? -8 : 8));
+
+  move_piece(from, to);
+
+  if (move_flag(move) == PROMOTION) {
+    remove_piece(to);
+    put_piece(make_piece(us, promotion_type(move)), to);
+  }
+
+  key ^= zobrist.castling[castling_rights];
+  castling_rights &= ~(rights_lost(from) | rights_lost(to));
+  key ^= zobrist.castling[castling_rights];
+
+  // only record an en passant square that an enemy pawn could take on
+  if (en_passant != NO_SQUARE)
+    key ^= zobrist.en_passant[square_file(en_passant)];
+  en_passant = NO_SQUARE;
+  if ((moving_type == PAWN) && (abs(to - from) == 16) && (pawn_attacks[us][(from + to) / 2] & pieces(us ^ 1, PAWN))) {
+    en_passant = (from + to) / 2;
+    key ^= zobrist.en_passant[square_file(en_passant)];
+  }
+
+  if ((moving_type == PAWN) || (undo.captured != NO_PIECE))
+    halfmove_clock = 0;
+  else
+    halfmove_clock++;
+
+  if (us == BLACK)
+    fullmove_number++;
+  side_to_move = us ^ 1;
+  key ^= zobrist.side;
+
+#ifdef DEBUG_HASH
+  verify_key();
+#endif
+}
+
+void Position::undo_move(Move move, const Undo &undo) {
+  int from = move_from(move);
+  int to = move_to(move);
+  int us = side_to_move ^ 1;
+
+  if (move_flag(move) == PROMOTION) {
+    remove_piece(to);
+    put_piece(make_piece(us, PAWN), to);
+  }
+
+  move_piece(to, from);
+
+  if (move_flag(move) == CASTLING) {
+    if (to > from)
+      move_piece(from + 1, from + 3);
+    else
+      move_piece(from - 1, from - 4);
+  }
+  else if (move_flag(move) == EN_PASSANT)
+    put_piece(undo.captured, to + ((us == WHITE) ? -8 : 8));
+  else if (undo.captured != NO_PIECE)
+    put_piece(undo.captured, to);
+
+  castling_rights = undo.castling_rights;
+  en_passant = undo.en_passant;
+  halfmove_clock = undo.halfmove_clock;
+  key = undo.key;
+
+  if (us == BLACK)
+    fullmove_number--;
+  side_to_move = us;
+
+#ifdef DEBUG_HASH
+  verify_key();
+#endif
+}
+
+/* -------------------- Queries -------------------- */
+Bitboard Position::attackers_to(int square, Bitboard occupied) const {
+  return (pawn_attacks[BLACK][square] & pieces(WHITE, PAWN))
+       | (pawn_attacks[WHITE][square] & pieces(BLACK, PAWN))
+       | (knight_attacks[square] & pieces_of_type(KNIGHT))
+       | (king_attacks[square] & pieces_of_type(KING))
+       | (bishop_attacks(square, occupied) & (pieces_of_type(BISHOP) | pieces_of_type(QUEEN)))
+       | (castle_attacks(square, occupied) & (pieces_of_type(CASTLE) | pieces_of_type(QUEEN)));
+}
+
+Key Position::compute_key() const {
+  Key result = zobrist.castling[castling_rights];
+
+  for (Bitboard b = occupied(); b; ) {
+    int square = pop_lsb(b);
+    result ^= zobrist.pieces[piece_on(square)][square];
+  }
+
+  if (side_to_move == BLACK)
+    result ^= zobrist.side;
+  if (en_passant != NO_SQUARE)
+    result ^= zobrist.en_passant[square_file(en_passant)];
+
+  return result;
+}
+
+void Position::verify_key() const {
+  if (key != compute_key()) {
+    std::cerr << "Zobrist key " << std::hex << key << " does not match recomputed key " << compute_key() << std::endl;
+    abort();
+  }
+}
+
+Bitboard Position::checkers() const {
+  return attackers_to(king_square(side_to_move), occupied()) & by_colour[side_to_move ^ 1];
+}
+
+Bitboard Position::pinned(int colour) const {
+  int king = king_square(colour);
+  int them = colour ^ 1;
+  Bitboard all = occupied();
+  Bitboard result = 0;
+
+  // enemy sliders that would attack the king on an empty board
+  Bitboard snipers = ((castle_attacks(king, 0) & (by_type[CASTLE] | by_type[QUEEN]))
+                    | (bishop_attacks(king, 0) & (by_type[BISHOP] | by_type[QUEEN]))) & by_colour[them];
+
+  while (snipers) {
+    Bitboard blockers = between[king][pop_lsb(snipers)] & all;
+
+    if (blockers && !(blockers & (blockers - 1)))
+      result |= blockers & by_colour[colour];
+  }
+  return result;
+}
+
+CheckInfo Position::check_info() const {
+  CheckInfo info;
+
+  info.checkers = checkers();
+  info.pinned = pinned(side_to_move);
+  return info;
+}
+
+bool Position::pseudo_legal(Move move) const {
+  int us = side_to_move;
+  int from = move_from(move);
+  int to = move_to(move);
+  int piece = piece_on(from);
+
+  if ((piece == NO_PIECE) || (piece_colour(piece) != us) || (by_colour[us] & square_bb(to)))
+    return false;
+
+  // only promotions carry a promotion piece, so every move has one encoding
+  if ((move_flag(move) != PROMOTION) && (promotion_type(move) != KNIGHT))
+    return false;
+
+  // legal compares these with the generated moves, which start from the right piece
+  if (move_flag(move) == CASTLING)
+    return piece_type(piece) == KING;
+  if (move_flag(move) == EN_PASSANT)
+    return piece_type(piece) == PAWN;
+
+  if (piece_type(piece) == PAWN) {
+    int forward = (us == WHITE) ? 8 : -8;
+
+    // a pawn reaching the last rank must promote, and only then
+    if ((square_rank(to) == ((us == WHITE) ? 7 : 0)) != (move_flag(move) == PROMOTION))
+      return false;
+    if (pawn_attacks[us][from] & square_bb(to))
+      return (by_colour[us ^ 1] & square_bb(to)) != 0;
+    if (to == from + forward)
+      return piece_on(to) == NO_PIECE;
+    return (to == from + 2 * forward) && (square_rank(from) == ((us == WHITE) ? 1 : 6)) &&
+           (piece_on(from + forward) == NO_PIECE) && (piece_on(to) == NO_PIECE);
+  }
+
+  if (move_flag(move) != NORMAL)
+    return false;
+
+  Bitboard all = occupied();
+  switch (piece_type(piece)) {
+    case KNIGHT: return (knight_attacks[from] & square_bb(to)) != 0;
+    case BISHOP: return (bishop_attacks(from, all) & square_bb(to)) != 0;
+    case CASTLE: return (castle_attacks(from, all) & square_bb(to)) != 0;
+    case QUEEN: return (queen_attacks(from, all) & square_bb(to)) != 0;
+    default: return (king_attacks[from] & square_bb(to)) != 0;
+  }
+}
+
+bool Position::legal(Move move, const CheckInfo &info) const {
+  int us = side_to_move;
+  int from = move_from(move);
+  int to = move_to(move);
+  int king = king_square(us);
+
+  // the rare special moves are checked against the generator
+  if ((move_flag(move) == CASTLING) || (move_flag(move) == EN_PASSANT)) {
+    MoveList moves;
+    generate_legal_moves(moves, info);
+    for (Move legal_move : moves) {
+      if (legal_move == move)
+        return true;
+    }
+    return false;
+  }
+
+  // the king may not step onto an attacked square, including one it now shields
+  if (from == king)
+    return !(attackers_to(to, occupied() ^ square_bb(king)) & by_colour[us ^ 1]);
+
+  // in double check only the king can move; in single check the checker must be taken or blocked
+  if (info.checkers & (info.checkers - 1))
+    return false;
+  if (info.checkers && !((between[king][lsb(info.checkers)] | info.checkers) & square_bb(to)))
+    return false;
+
+  // a pinned piece may only slide along the pin
+  return !(info.pinned & square_bb(from)) || (line[king][from] & square_bb(to));
+}
+
+/* -------------------- Move generation -------------------- */
+void Position::generate_legal_moves(MoveList &moves) const {
+  generate_legal_moves(moves, check_info());
+}
+
+void Position::generate_legal_moves(MoveList &moves, const CheckInfo &info) const {
+  int us = side_to_move;
+  int them = us ^ 1;
+  int king = king_square(us);
+  Bitboard own = by_colour[us];
+  Bitboard all = occupied();
+  Bitboard checking = info.checkers;
+
+  // king moves are tested with the king lifted off the board, so it cannot hide behind itself
+  Bitboard without_king = all ^ square_bb(king);
+  for (Bitboard b = king_attacks[king] & ~own; b; ) {
+    int to = pop_lsb(b);
+    if (!(attackers_to(to, without_king) & by_colour[them]))
+      moves.add(create_move(king, to));
+  }
+
+  // in double check only the king can move
+  if (checking & (checking - 1))
+    return;
+
+  // otherwise other pieces must take or block a single checker
+  Bitboard target = ~own;
+  if (checking)
+    target &= between[king][lsb(checking)] | checking;
+  else
+    generate_castling(moves);
+
+  Bitboard pins = info.pinned;
+  generate_pawn_moves(moves, target, pins);
+
+  for (int type = KNIGHT; type <= QUEEN; type++) {
+    for (Bitboard b = pieces(us, type); b; ) {
+      int from = pop_lsb(b);
+      Bitboard attacks = piece_attacks(type, from, all) & target;
+
+      // a pinned piece may only slide along the pin
+      if (pins & square_bb(from))
+        attacks &= line[king][from];
+
+      while (attacks)
+        moves.add(create_move(from, pop_lsb(attacks)));
+    }
+  }
+}
+
+void Position::generate_pawn_moves(MoveList &moves, Bitboard target, Bitboard pins) const {
+  int us = side_to_move;
+  int king = king_square(us);
+  int last_rank = (us == WHITE) ? 7 : 0;
+  Bitboard all = occupied();
+
+  for (Bitboard b = pieces(us, PAWN); b; ) {
+    int from = pop_lsb(b);
+    Bitboard pushes = 0;
+
+    // pushes need an empty destination and an empty square to pass over
+    for (Bitboard p = pawn_pushes[us][from] & ~all; p; ) {
+      int to = pop_lsb(p);
+      if (!(between[from][to] & all))
+        pushes |= square_bb(to);
+    }
+
+    Bitboard destinations = (pushes | (pawn_attacks[us][from] & by_colour[us ^ 1])) & target;
+    if (pins & square_bb(from))
+      destinations &= line[king][from];
+
+    while (destinations) {
+      int to = pop_lsb(destinations);
+
+      if (square_rank(to) == last_rank) {
+        for (int type = QUEEN; type >= KNIGHT; type--)
+          moves.add(create_move(from, to, PROMOTION, type));
+      }
+      else
+        moves.add(create_move(from, to));
+    }
+
+    if ((en_passant != NO_SQUARE) && (pawn_attacks[us][from] & square_bb(en_passant)) && legal_en_passant(from))
+      moves.add(create_move(from, en_passant, EN_PASSANT));
+  }
+}
+
+bool Position::legal_en_passant(int from) const {
+  int us = side_to_move;
+  int king = king_square(us);
+  int taken = en_passant + ((us == WHITE) ? -8 : 8);
+
+  // both pawns leave their squares at once, which can expose the king along a rank
+  Bitboard after = (occupied() ^ square_bb(from) ^ square_bb(taken)) | square_bb(en_passant);
+
+  return !(attackers_to(king, after) & by_colour[us ^ 1] & ~square_bb(taken));
+}
+
+void Position::generate_castling(MoveList &moves) const {
+  int us = side_to_move;
+  int them = us ^ 1;
+  int king = king_square(us);
+  int kingside = (us == WHITE) ? WHITE_KINGSIDE : BLACK_KINGSIDE;
+  int queenside = (us == WHITE) ? WHITE_QUEENSIDE : BLACK_QUEENSIDE;
+  Bitboard all = occupied();
+
+  // the king may not pass through or land on an attacked square
+  if ((castling_rights & kingside) && !(between[king][king + 3] & all)
+      && !(attackers_to(king + 1, all) & by_colour[them]) && !(attackers_to(king + 2, all) & by_colour[them]))
+    moves.add(create_move(king, king + 2, CASTLING));
+
+  if ((castling_rights & queenside) && !(between[king][king - 4] & all)
+      && !(attackers_to(king - 1, all) & by_colour[them]) && !(attackers_to(king - 2, all) & by_colour[them]))
+    moves.add(create_move(king, king - 2, CASTLING));
+}
+
+/* -------------------- Helpers -------------------- */
+FenError Position::check_pieces() const {
+  if ((pop_count(pieces(WHITE, KING)) != 1) || (pop_count(pieces(BLACK, KING)) != 1))
+    return FEN_BAD_KINGS;
+  if (pieces_of_type(PAWN) & 0xFF000000000000FFULL)
+    return FEN_BAD_PAWNS;
+  return FEN_OK;
+}
+
+bool Position::valid_castling() const {
+  // every right needs its king and castle still on their starting squares
+  for (int right = 0; right < 4; right++) {
+    int colour = right / 2;
+    int king = (colour == WHITE) ? 4 : 60;
+    int castle = king + ((right & 1) ? -4 : 3);
+
+    if ((castling_rights & (1 << right)) &&
+        ((piece_on(king) != make_piece(colour, KING)) || (piece_on(castle) != make_piece(colour, CASTLE))))
+      return false;
+  }
+  return true;
+}
+
+bool Position::set_en_passant(int square) {
+  int us = side_to_move;
+  int them = us ^ 1;
+
+  // the square a pawn of the side that has just moved passed over on its double step
+  if (square_rank(square) != ((us == WHITE) ? 5 : 2))
+    return false;
+
+  int pawn = square + ((us == WHITE) ? -8 : 8);
+  int start = square + ((us == WHITE) ? 8 : -8);
+
+  if ((piece_on(pawn) != make_piece(them, PAWN)) || (piece_on(square) != NO_PIECE) || (piece_on(start) != NO_PIECE))
+    return false;
+
+  if (pawn_attacks[them][square] & pieces(us, PAWN))
+    en_passant = square;
+  return true;
+}
+
+bool Position::opponent_in_check() const {
+  return attackers_to(king_square(side_to_move ^ 1), occupied()) & pieces(side_to_move);
+}
+
+void Position::finish_key() {
+  // put_piece has already added the pieces to the key
+  key ^= zobrist.castling[ALL_CASTLING] ^ zobrist.castling[castling_rights];
+  if (side_to_move == BLACK)
+    key ^= zobrist.side;
+  if (en_passant != NO_SQUARE)
+    key ^= zobrist.en_passant[square_file(en_passant)];
+}
@@ -0,0 +1,264 @@
+#ifndef POSITION_H
+#define POSITION_H
+
+#include<string>
+#include<string_view>
+#include<type_traits>
+
+#include"Bitboard.h"
+#include"Move.h"
+#include"Zobrist.h"
+
+enum Colour { WHITE, BLACK };
+enum PieceType { PAWN, KNIGHT, BISHOP, CASTLE, QUEEN, KING };
+
+/* Castling rights, one bit per side and colour */
+enum CastlingRight { WHITE_KINGSIDE = 1, WHITE_QUEENSIDE = 2, BLACK_KINGSIDE = 4, BLACK_QUEENSIDE = 8, ALL_CASTLING = 15 };
+
+/* Pieces are coded as (colour << 3) | type */
+const int NO_PIECE = 15;
+
+/* Marks the absence of an en passant square */
+const int NO_SQUARE = 64;
+
+/* Return the piece code for a piece of colour and type */
+inline int make_piece(int colour, int type) {
+  return (colour << 3) | type;
+}
+
+/* Return the colour of a piece code */
+inline int piece_colour(int piece) {
+  return piece >> 3;
+}
+
+/* Return the type of a piece code */
+inline int piece_type(int piece) {
+  return piece & 7;
+}
+
+/* Why a FEN string or snapshot could not be read */
+enum FenError {
+  FEN_OK,
+  /* Missing fields, or text after the move clocks */
+  FEN_BAD_FIELDS,
+  FEN_BAD_PLACEMENT,
+  FEN_BAD_KINGS,
+  /* A pawn on the first or last rank */
+  FEN_BAD_PAWNS,
+  FEN_BAD_SIDE,
+  FEN_BAD_CASTLING,
+  FEN_BAD_EN_PASSANT,
+  FEN_BAD_CLOCKS,
+  /* The side that has just moved left its king in check */
+  FEN_OPPONENT_IN_CHECK,
+  /* A snapshot whose contents were changed after it was saved */
+  FEN_BAD_SNAPSHOT
+};
+
+/* Return a description of error for the user */
+const char* fen_error_message(FenError error);
+
+/* Longest FEN written by Position::write_fen, with its terminating null */
+const int MAX_FEN_LENGTH = 92;
+
+/* A position packed into 40 bytes for checkpoints: the piece codes as
+   Position keeps them, the game state, and 16 check bits to catch damage. Pawns can only be on their starting rank before their
+   first move, so the board also says which may still advance two squares. */
+struct Snapshot {
+  uint8_t board[32];
+  uint8_t side_to_move;
+  uint8_t castling_rights;
+  uint8_t en_passant;
+  uint8_t halfmove_clock;
+  uint16_t fullmove_number;
+  /* Low 16 bits of the Zobrist key, mixed with the move clocks */
+  uint16_t check;
+};
+
+static_assert(sizeof(Snapshot) == 40, "Snapshot is part of the checkpoint format");
+
+/* Checks and pins against the side to move, computed once per position
+   and shared by the queries that need them */
+struct CheckInfo {
+  /* Enemy pieces giving check */
+  Bitboard checkers;
+  /* Pieces of the side to move pinned to their king */
+  Bitboard pinned;
+};
+
+/* State overwritten by a move, saved so the move can be taken back */
+struct Undo {
+  Key key;
+  uint8_t captured;
+  uint8_t castling_rights;
+  uint8_t en_passant;
+  uint8_t halfmove_clock;
+};
+
+/* Bitboard representation of the pieces on a chess board and the state
+   needed to generate legal moves from it. A plain value of at most 128
+   bytes, so copying a position is a memcpy. */
+class Position {
+private:
+  Bitboard by_type[6];
+  Bitboard by_colour[2];
+  /* Zobrist key, updated with every change to the position */
+  Key key;
+  /* Piece codes, two squares per byte with the lower square in the low nibble */
+  uint8_t board[32];
+  uint8_t side_to_move;
+  uint8_t castling_rights;
+  uint8_t en_passant;
+  uint8_t halfmove_clock;
+  uint16_t fullmove_number;
+  /* Square of each king, kept up to date as pieces move */
+  uint8_t king_squares[2];
+
+  /* Set the piece code held for square */
+  void set_board(int square, int piece) {
+    int shift = (square & 1) << 2;
+    board[square >> 1] = static_cast<uint8_t>((board[square >> 1] & ~(15 << shift)) | (piece << shift));
+  }
+
+  /* Abort if the incremental key has drifted from a full recomputation (DEBUG_HASH builds only) */
+  void verify_key() const;
+
+  /* Add the legal pawn moves for the side to move */
+  void generate_pawn_moves(MoveList &moves, Bitboard target, Bitboard pins) const;
+
+  /* Add the legal castling moves for the side to move */
+  void generate_castling(MoveList &moves) const;
+
+  /* Return true if an en passant capture from from leaves the king safe */
+  bool legal_en_passant(int from) const;
+
+  /* Return FEN_BAD_KINGS or FEN_BAD_PAWNS if the pieces placed cannot stand together, otherwise FEN_OK */
+  FenError check_pieces() const;
+
+  /* Return true if every castling right has its king and castle on their starting squares */
+  bool valid_castling() const;
+
+  /* Return false if no pawn of the side that has just moved passed over square with a double step.
+     Otherwise make square the en passant square if a pawn can take on it, and return true. */
+  bool set_en_passant(int square);
+
+  /* Return true if the side not to move is in check */
+  bool opponent_in_check() const;
+
+  /* Add the side to move, castling rights and en passant square to the key of a position placed piece by piece */
+  void finish_key();
+
+public:
+  /* -------------------- Constructors -------------------- */
+  Position();
+
+  /* Remove all pieces and reset the game state to White's first move with full castling rights */
+  void clear();
+
+  /* Set up the position described by a FEN string, without allocating. The en passant
+     square is kept only if a pawn could take on it, as after do_move. Return FEN_OK,
+     or why the string cannot be read, in which case the position is unchanged. */
+  FenError load_fen(std::string_view fen);
+
+  /* Set up the position described by a FEN string. Return false if it cannot be read. */
+  bool set_fen(std::string_view fen) { return load_fen(fen) == FEN_OK; }
+
+  /* Write the position as a null-terminated FEN string of at most MAX_FEN_LENGTH
+     characters into out. Return its length. */
+  int write_fen(char out[]) const;
+
+  /* Return the position as a FEN string */
+  std::string fen() const;
+
+  /* Pack the position into snapshot */
+  void save_snapshot(Snapshot &snapshot) const;
+
+  /* Set up the position packed in snapshot, making the same checks as load_fen. Return FEN_OK,
+     or why it cannot be read, in which case the position is unchanged. */
+  FenError load_snapshot(const Snapshot &snapshot);
+
+  /* -------------------- Board updates -------------------- */
+  /* Place piece on an empty square */
+  void put_piece(int piece, int square);
+
+  /* Remove the piece on square and return it */
+  int remove_piece(int square);
+
+  /* Move the piece on from to to and return the piece taken, if any */
+  int move_piece(int from, int to);
+
+  /* Play a legal move for the side to move, saving what it overwrites to undo */
+  void do_move(Move move, Undo &undo);
+
+  /* Take back move, the last move played, using the state saved by do_move */
+  void undo_move(Move move, const Undo &undo);
+
+  /* -------------------- Queries -------------------- */
+  /* Return the piece on square, or NO_PIECE */
+  int piece_on(int square) const { return (board[square >> 1] >> ((square & 1) << 2)) & 15; }
+
+  /* Return the squares holding pieces of colour and type */
+  Bitboard pieces(int colour, int type) const { return by_type[type] & by_colour[colour]; }
+
+  /* Return the squares holding pieces of colour */
+  Bitboard pieces(int colour) const { return by_colour[colour]; }
+
+  /* Return the squares holding pieces of type of either colour */
+  Bitboard pieces_of_type(int type) const { return by_type[type]; }
+
+  /* Return the squares holding any piece */
+  Bitboard occupied() const { return by_colour[WHITE] | by_colour[BLACK]; }
+
+  /* Return the square of the king of colour */
+  int king_square(int colour) const { return king_squares[colour]; }
+
+  /* Return the colour to move */
+  int side() const { return side_to_move; }
+
+  /* Return the square a pawn can take en passant on, or NO_SQUARE */
+  int en_passant_square() const { return en_passant; }
+
+  /* Return the number of moves since the last capture or pawn move */
+  int halfmoves() const { return halfmove_clock; }
+
+  /* Return the move number, starting at 1 and increasing after Black moves */
+  int fullmoves() const { return fullmove_number; }
+
+  /* Return the Zobrist key of the position */
+  Key hash() const { return key; }
+
+  /* Return the Zobrist key of the position, computed from scratch */
+  Key compute_key() const;
+
+  /* Return the pieces of either colour attacking square when occupied squares block sliders */
+  Bitboard attackers_to(int square, Bitboard occupied) const;
+
+  /* Return the enemy pieces giving check to the side to move */
+  Bitboard checkers() const;
+
+  /* Return the pieces of colour that are the only blocker between their king and an enemy slider */
+  Bitboard pinned(int colour) const;
+
+  /* Return the checkers and pinned pieces of the side to move */
+  CheckInfo check_info() const;
+
+  /* Return true if move follows the movement rules for the side to move, as legal requires. Any
+     16-bit value may be tested. Castling and en passant moves are only checked in full by legal. */
+  bool pseudo_legal(Move move) const;
+
+  /* Return true if move, which must follow the movement rules for the side to move,
+     leaves its king safe. info must be the check_info of this position. */
+  bool legal(Move move, const CheckInfo &info) const;
+
+  /* -------------------- Move generation -------------------- */
+  /* Add every legal move for the side to move */
+  void generate_legal_moves(MoveList &moves) const;
+
+  /* As generate_legal_moves, given the check_info of this position */
+  void generate_legal_moves(MoveList &moves, const CheckInfo &info) const;
+};
+
+static_assert(std::is_trivially_copyable<Position>::value, "Position must copy as plain memory");
+static_assert(sizeof(Position) <= 128, "Position must fit in two cache lines");
+
+#endif
@@ -0,0 +1,373 @@
+#include<algorithm>
+#include<cstdio>
+#include<cstring>
+#include<queue>
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unistd.h>
+
+using namespace std;
+
+#include"PositionIndex.h"
+#include"ChessBoard.h"
+#include"GameDatabase.h"
+
+
+/* Identifies index files, and the version of the layout they use */
+static const char index_magic[8] = {'C', 'H', 'E', 'S', 'S', 'I', 'D', 'X'};
+static const uint32_t index_version = 1;
+
+/* Sort postings by key, a byte at a time, keeping postings with equal keys in the order they were in,
+   using scratch as room to move them in */
+static void sort_by_key(vector<Posting> &postings, vector<Posting> &scratch) {
+  uint64_t counts[8][256] = {};
+
+  for (const Posting &posting : postings) {
+    for (int byte = 0; byte < 8; byte++)
+      counts[byte][(posting.key >> (8 * byte)) & 0xFF]++;
+  }
+
+  scratch.resize(postings.size());
+  for (int byte = 0; byte < 8; byte++) {
+    uint64_t offsets[256];
+    uint64_t offset = 0;
+
+    // every key has the same byte here, so the pass would change nothing
+    if (counts[byte][(postings[0].key >> (8 * byte)) & 0xFF] == postings.size())
+      continue;
+
+    for (int value = 0; value < 256; value++) {
+      offsets[value] = offset;
+      offset += counts[byte][value];
+    }
+    for (const Posting &posting : postings)
+      scratch[offsets[(posting.key >> (8 * byte)) & 0xFF]++] = posting;
+    postings.swap(scratch);
+  }
+}
+
+/* Return the key of a posting, or the key itself, so postings can be searched by key */
+static Key key_of(const Posting &posting) {
+  return posting.key;
+}
+
+static Key key_of(Key key) {
+  return key;
+}
+
+/* Return true if header starts an index */
+static bool valid_header(const IndexHeader &header) {
+  return (memcmp(header.magic, index_magic, sizeof(header.magic)) == 0) && (header.version == index_version);
+}
+
+
+/* -------------------- PositionIndexWriter -------------------- */
+/* -------------------- Constructors -------------------- */
+PositionIndexWriter::PositionIndexWriter(size_t batch_postings)
+  : header(IndexHeader()), end(0), batch_postings(max<size_t>(batch_postings, 1024)), batch_first_game(0), skipped_games(0) {}
+
+bool PositionIndexWriter::open(const string &path) {
+  this->path = path;
+  header = IndexHeader();
+  batch.clear();
+
+  out.open(path, ios::binary | ios::in | ios::out);
+
+  // there is no index yet
+  if (!out.is_open()) {
+    out.clear();
+    out.open(path, ios::binary | ios::in | ios::out | ios::trunc);
+    memcpy(header.magic, index_magic, sizeof(header.magic));
+    header.version = index_version;
+    end = sizeof(header);
+    batch_first_game = 0;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.flush();
+    return out.good();
+  }
+
+  out.seekg(0, ios::end);
+  uint64_t length = out.tellg();
+  out.seekg(0);
+
+  if (!out.read(reinterpret_cast<char*>(&header), sizeof(header)) || !valid_header(header)) {
+    out.close();
+    return false;
+  }
+
+  // new segments go after the last one the header counts
+  end = sizeof(header);
+  for (uint32_t i = 0; i < header.segment_count; i++) {
+    IndexSegment segment;
+
+    out.seekg(end);
+    if (!out.read(reinterpret_cast<char*>(&segment), sizeof(segment)) ||
+        (segment.posting_count > (length - end - sizeof(segment)) / sizeof(Posting))) {
+      out.close();
+      return false;
+    }
+    end += sizeof(segment) + segment.posting_count * sizeof(Posting);
+  }
+
+  batch_first_game = header.game_count;
+  return true;
+}
+
+bool PositionIndexWriter::close() {
+  if (!out.is_open())
+    return false;
+
+  bool written = write_segment();
+
+  out.close();
+  written = written && !out.fail();
+  if (written && (header.segment_count > MAX_SEGMENTS))
+    written = merge_segments();
+  return written;
+}
+
+/* -------------------- Games -------------------- */
+int64_t PositionIndexWriter::add_games(const GameDatabase &database, ChessBoard &board) {
+  uint64_t first = header.game_count;
+  // games are numbered in 32 bits
+  uint64_t last = min<uint64_t>(database.size(), UINT32_MAX);
+  StoredGame game;
+
+  if (!out.is_open() || (database.size() < first))
+    return -1;
+
+  for (uint64_t number = first; number < last; number++) {
+    // games never straddle two segments
+    if ((batch.size() >= batch_postings) && !write_segment())
+      return -1;
+    header.game_count++;
+
+    if (!database.game(number, game) || (!game.fen.empty() && (board.load_fen(game.fen) != FEN_OK))) {
+      skipped_games++;
+      continue;
+    }
+    if (game.fen.empty())
+      board.resetBoard(true);
+
+    size_t game_start = batch.size();
+    Posting posting = Posting();
+    posting.game = static_cast<uint32_t>(number);
+    posting.key = board.hash();
+    batch.push_back(posting);
+
+    for (int ply = 0; (ply < game.plies) && (ply < UINT16_MAX); ply++) {
+      // the file may be damaged, so a game is only indexed if every move is legal
+      if (!board.legal_move(game.moves[ply])) {
+        batch.resize(game_start);
+        skipped_games++;
+        break;
+      }
+      board.make_move(game.moves[ply]);
+      posting.key = board.hash();
+      posting.ply = static_cast<uint16_t>(ply + 1);
+      batch.push_back(posting);
+    }
+  }
+  return last - first;
+}
+
+/* -------------------- Helpers -------------------- */
+bool PositionIndexWriter::write_segment() {
+  if (header.game_count == batch_first_game)
+    return true;
+
+  // postings are added in game and ply order, so once sorted by key a position
+  // repeated within a game is kept at its first ply only
+  if (!batch.empty())
+    sort_by_key(batch, scratch);
+  batch.erase(unique(batch.begin(), batch.end(), [](const Posting &a, const Posting &b) {
+    return (a.key == b.key) && (a.game == b.game);
+  }), batch.end());
+
+  IndexSegment segment = IndexSegment();
+  segment.posting_count = batch.size();
+  segment.first_game = batch_first_game;
+  segment.game_count = header.game_count - batch_first_game;
+
+  out.seekp(end);
+  out.write(reinterpret_cast<const char*>(&segment), sizeof(segment));
+  out.write(reinterpret_cast<const char*>(batch.data()), batch.size() * sizeof(Posting));
+  out.flush();
+  if (!out.good())
+    return false;
+
+  end += sizeof(segment) + batch.size() * sizeof(Posting);
+  header.segment_count++;
+  header.posting_count += batch.size();
+  batch.clear();
+  batch_first_game = header.game_count;
+
+  // the new segment only counts once the header says so
+  out.seekp(0);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.flush();
+  return out.good();
+}
+
+bool PositionIndexWriter::merge_segments() {
+  PositionIndex index;
+  string temporary = path + ".tmp";
+  ofstream merged(temporary, ios::binary | ios::trunc);
+
+  if (!index.open(path) || !merged)
+    return false;
+
+  IndexHeader merged_header = header;
+  IndexSegment segment = IndexSegment();
+  merged_header.segment_count = 1;
+  segment.posting_count = header.posting_count;
+  segment.game_count = header.game_count;
+  merged.write(reinterpret_cast<const char*>(&merged_header), sizeof(merged_header));
+  merged.write(reinterpret_cast<const char*>(&segment), sizeof(segment));
+
+  // each cursor is the next posting of a segment; among equal keys the older segment holds the earlier games
+  struct Cursor {
+    const Posting* next;
+    const Posting* end;
+    int segment;
+  };
+  auto after = [](const Cursor &a, const Cursor &b) {
+    return (a.next->key != b.next->key) ? (a.next->key > b.next->key) : (a.segment > b.segment);
+  };
+  priority_queue<Cursor, vector<Cursor>, decltype(after)> cursors(after);
+
+  for (int i = 0; i < index.segment_count(); i++) {
+    uint64_t count;
+    const Posting* postings = index.segment(i, count);
+
+    if (count > 0)
+      cursors.push(Cursor{postings, postings + count, i});
+  }
+
+  vector<Posting> buffer;
+  buffer.reserve(1 << 16);
+
+  while (!cursors.empty()) {
+    Cursor cursor = cursors.top();
+    Key key = cursor.next->key;
+    cursors.pop();
+
+    // the whole run of the key in this segment goes out together
+    do {
+      buffer.push_back(*cursor.next++);
+    } while ((cursor.next != cursor.end) && (cursor.next->key == key));
+
+    if (cursor.next != cursor.end)
+      cursors.push(cursor);
+    if (buffer.size() >= (1 << 16)) {
+      merged.write(reinterpret_cast<const char*>(buffer.data()), buffer.size() * sizeof(Posting));
+      buffer.clear();
+    }
+  }
+  merged.write(reinterpret_cast<const char*>(buffer.data()), buffer.size() * sizeof(Posting));
+  merged.close();
+  index.close();
+
+  if (merged.fail() || (rename(temporary.c_str(), path.c_str()) != 0)) {
+    remove(temporary.c_str());
+    return false;
+  }
+  header = merged_header;
+  return true;
+}
+
+
+/* -------------------- PositionIndex -------------------- */
+/* -------------------- Constructors -------------------- */
+PositionIndex::PositionIndex() : data(NULL), length(0), header(IndexHeader()) {}
+
+PositionIndex::~PositionIndex() {
+  close();
+}
+
+bool PositionIndex::open(const string &path) {
+  struct stat status;
+  int file = ::open(path.c_str(), O_RDONLY);
+
+  close();
+  if (file < 0)
+    return false;
+
+  if ((fstat(file, &status) == 0) && (status.st_size >= static_cast<off_t>(sizeof(IndexHeader)))) {
+    void* mapped = mmap(NULL, status.st_size, PROT_READ, MAP_SHARED, file, 0);
+
+    if (mapped != MAP_FAILED) {
+      data = static_cast<const char*>(mapped);
+      length = status.st_size;
+    }
+  }
+  ::close(file);
+
+  if (data == NULL)
+    return false;
+
+  memcpy(&header, data, sizeof(header));
+  if (!valid_header(header)) {
+    close();
+    return false;
+  }
+
+  // every segment must lie within the file
+  uint64_t offset = sizeof(header);
+  for (uint32_t i = 0; i < header.segment_count; i++) {
+    IndexSegment segment;
+
+    if (offset + sizeof(segment) > length) {
+      close();
+      return false;
+    }
+    memcpy(&segment, data + offset, sizeof(segment));
+    offset += sizeof(segment);
+
+    if (segment.posting_count > (length - offset) / sizeof(Posting)) {
+      close();
+      return false;
+    }
+    runs.push_back(Run{reinterpret_cast<const Posting*>(data + offset), segment.posting_count});
+    offset += segment.posting_count * sizeof(Posting);
+  }
+  return true;
+}
+
+void PositionIndex::close() {
+  if (data != NULL)
+    munmap(const_cast<char*>(data), length);
+
+  data = NULL;
+  length = 0;
+  header = IndexHeader();
+  runs.clear();
+}
+
+/* -------------------- Queries -------------------- */
+uint64_t PositionIndex::find(Key key, vector<Posting> &postings, uint64_t limit) const {
+  size_t start = postings.size();
+  uint64_t found = 0;
+
+  for (const Run &run : runs) {
+    auto range = equal_range(run.postings, run.postings + run.count, key, [](const auto &a, const auto &b) {
+      return key_of(a) < key_of(b);
+    });
+    uint64_t count = range.second - range.first;
+    uint64_t taken = min<uint64_t>(count, limit - min<uint64_t>(limit, postings.size() - start));
+
+    postings.insert(postings.end(), range.first, range.first + taken);
+    found += count;
+  }
+  return found;
+}
+
+uint64_t PositionIndex::find(ChessBoard &board, vector<Posting> &postings, uint64_t limit) const {
+  return find(board.hash(), postings, limit);
+}
+
+const Posting* PositionIndex::segment(int number, uint64_t &count) const {
+  count = runs[number].count;
+  return runs[number].postings;
+}
@@ -0,0 +1,151 @@
+#ifndef POSITIONINDEX_H
+#define POSITIONINDEX_H
+
+#include<cstdint>
+#include<fstream>
+#include<string>
+#include<vector>
+
+#include"Zobrist.h"
+
+class ChessBoard;
+class GameDatabase;
+
+/* Index files are laid out in host byte order as an IndexHeader followed by
+   segments, each an IndexSegment and its postings sorted by key, game and
+   ply. Every segment covers the games after those of the segment before, so
+   new games are indexed by adding a segment to the end; the header is
+   rewritten last, so a segment cut short is never read. */
+
+/* Start of every index file */
+struct IndexHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t segment_count;
+  /* Games of the database indexed so far */
+  uint64_t game_count;
+  uint64_t posting_count;
+};
+
+static_assert(sizeof(IndexHeader) == 32, "IndexHeader is part of the file format");
+
+/* Start of every segment */
+struct IndexSegment {
+  uint64_t posting_count;
+  uint64_t first_game;
+  uint64_t game_count;
+  uint64_t reserved;
+};
+
+static_assert(sizeof(IndexSegment) == 32, "IndexSegment is part of the file format");
+
+/* A position reached in a game. Only the first time a game reaches a position is indexed. */
+struct Posting {
+  Key key;
+  /* Game number in the database, from 0 */
+  uint32_t game;
+  /* Plies played before the position was reached */
+  uint16_t ply;
+  uint16_t reserved;
+};
+
+static_assert(sizeof(Posting) == 16, "Posting is part of the file format");
+
+/* Builds the index of a database, or brings an existing one up to date with games added since */
+class PositionIndexWriter {
+private:
+  /* Segments beyond which close merges them all into one */
+  static const int MAX_SEGMENTS = 16;
+
+  std::string path;
+  std::fstream out;
+  IndexHeader header;
+  /* Offset just past the last segment */
+  uint64_t end;
+  size_t batch_postings;
+  std::vector<Posting> batch;
+  /* Room for sorting the batch */
+  std::vector<Posting> scratch;
+  uint64_t batch_first_game;
+  /* Games left out of the index because they could not be read or replayed */
+  uint64_t skipped_games;
+
+  /* Sort the batch and write it as a new segment */
+  bool write_segment();
+
+  /* Merge every segment into one, replacing the file. Return false if it could not be rewritten. */
+  bool merge_segments();
+
+public:
+  /* -------------------- Constructors -------------------- */
+  /* Hold about batch_postings postings in memory, twice over while sorting, before writing them out as a segment */
+  PositionIndexWriter(size_t batch_postings = 1 << 22);
+
+  /* Open the index at path to add to it, or start a new one if there is none. Return false if the
+     file there is not an index or cannot be written. */
+  bool open(const std::string &path);
+
+  /* Write out the last segment, merging the segments if there are too many. Return false if anything could not be written. */
+  bool close();
+
+  /* -------------------- Games -------------------- */
+  /* Return the number of games indexed */
+  uint64_t size() const { return header.game_count; }
+
+  /* Return the number of games added since opening that are damaged and have no positions in the index */
+  uint64_t skipped() const { return skipped_games; }
+
+  /* Index the games of database after those already indexed, replaying them into board. A game whose
+     record is damaged or holds an illegal move is skipped, keeping its number. Return the number of
+     games added, or -1 if the database holds fewer games than the index or a segment could not be written. */
+  int64_t add_games(const GameDatabase &database, ChessBoard &board);
+};
+
+/* An index file mapped into memory, answering which games reach a position */
+class PositionIndex {
+private:
+  /* The postings of one segment */
+  struct Run {
+    const Posting* postings;
+    uint64_t count;
+  };
+
+  const char* data;
+  size_t length;
+  IndexHeader header;
+  std::vector<Run> runs;
+
+public:
+  /* -------------------- Constructors -------------------- */
+  PositionIndex();
+  ~PositionIndex();
+  PositionIndex(const PositionIndex&) = delete;
+  PositionIndex& operator=(const PositionIndex&) = delete;
+
+  /* Map the index at path. Return false if it cannot be read or is not an index. */
+  bool open(const std::string &path);
+
+  /* Unmap the index, if any */
+  void close();
+
+  /* -------------------- Queries -------------------- */
+  /* Return the number of games indexed */
+  uint64_t size() const { return header.game_count; }
+
+  /* Return the number of postings over all games */
+  uint64_t posting_count() const { return header.posting_count; }
+
+  /* Add to postings, in game order, up to limit of the games reaching the position with key. Return how many games reach it. */
+  uint64_t find(Key key, std::vector<Posting> &postings, uint64_t limit = UINT64_MAX) const;
+
+  /* Find the games reaching the current position of board */
+  uint64_t find(ChessBoard &board, std::vector<Posting> &postings, uint64_t limit = UINT64_MAX) const;
+
+  /* Return the number of segments */
+  int segment_count() const { return runs.size(); }
+
+  /* Return the postings of segment number, oldest first, and set count to how many there are */
+  const Posting* segment(int number, uint64_t &count) const;
+};
+
+#endif
@@ -0,0 +1,281 @@
+#include<algorithm>
+#include<cctype>
+#include<chrono>
+#include<fstream>
+#include<iostream>
+#include<thread>
+
+using namespace std;
+
+#include"Replay.h"
+#include"ChessBoard.h"
+#include"ThreadPool.h"
+
+
+/* Game termination markers, which end the movetext of every game */
+static const char* const result_tokens[] = {"1-0", "0-1", "1/2-1/2", "*"};
+
+/* Return true if the line of text from start to end holds only whitespace */
+static bool blank_line(const string &text, size_t start, size_t end) {
+  for (size_t i = start; i < end; i++) {
+    if (!isspace(static_cast<unsigned char>(text[i])))
+      return false;
+  }
+  return true;
+}
+
+/* Return true if the line of text from start to end ends with a game termination marker */
+static bool ends_with_result(const string &text, size_t start, size_t end) {
+  while ((end > start) && isspace(static_cast<unsigned char>(text[end - 1])))
+    end--;
+
+  size_t token = end;
+  while ((token > start) && !isspace(static_cast<unsigned char>(text[token - 1])))
+    token--;
+
+  for (const char* result : result_tokens) {
+    if (text.compare(token, end - token, result) == 0)
+      return true;
+  }
+  return false;
+}
+
+void print_replay_stats(ostream &os, const ReplayStats &stats) {
+  os << stats.games << " games, " << stats.failed << " failed, " << stats.plies << " plies in " << stats.seconds << " s ("
+     << ((stats.seconds > 0) ? stats.games / stats.seconds : 0.0) << " games/s, "
+     << ((stats.seconds > 0) ? stats.plies / stats.seconds : 0.0) << " plies/s)" << endl;
+}
+
+
+/* -------------------- ReplayPipeline -------------------- */
+/* -------------------- Constructor -------------------- */
+ReplayPipeline::ReplayPipeline(int thread_count, int reader_count, bool errors_only, size_t chunk_bytes)
+  : thread_count(max(thread_count, 1)), reader_count(max(reader_count, 1)), errors_only(errors_only), chunk_bytes(max<size_t>(chunk_bytes, 4096)),
+    max_in_flight(4 * max(thread_count, 1)), files(NULL), next_file(0), head_file(0), in_flight(0), bytes(0) {}
+
+ReplayPipeline::~ReplayPipeline() {}
+
+/* -------------------- Replay -------------------- */
+bool ReplayPipeline::run(const vector<string> &files, ostream &out, ReplayStats &stats) {
+  ThreadPool pool(thread_count);
+  vector<thread> readers;
+  bool all_read = true;
+  auto start = chrono::steady_clock::now();
+
+  this->files = &files;
+  boards.assign(pool.size(), ChessBoard(true));
+  states.assign(files.size(), FileState());
+  next_file = 0;
+  head_file = 0;
+  in_flight = 0;
+  bytes = 0;
+  stats = ReplayStats();
+
+  for (int i = 0; i < min<int>(reader_count, files.size()); i++)
+    readers.emplace_back(&ReplayPipeline::read_files, this, ref(pool));
+
+  for (size_t file = 0; file < files.size(); file++) {
+    {
+      lock_guard<mutex> guard(lock);
+      head_file = file;
+    }
+    changed.notify_all();
+
+    write_file(file, out, stats);
+    if (states[file].missing) {
+      out << "Cannot open " << files[file] << "!" << endl;
+      all_read = false;
+    }
+  }
+
+  for (thread &reader : readers)
+    reader.join();
+  pool.wait();
+
+  stats.bytes = bytes;
+  stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  return all_read;
+}
+
+void ReplayPipeline::read_files(ThreadPool &pool) {
+  while (true) {
+    int file;
+    {
+      lock_guard<mutex> guard(lock);
+      if (next_file >= static_cast<int>(files->size()))
+        return;
+      file = next_file++;
+    }
+
+    const string &name = (*files)[file];
+    ifstream stream;
+    if (name != "-")
+      stream.open(name, ios::binary);
+    istream &in = (name == "-") ? cin : stream;
+
+    string carry;
+    uint64_t line = 1;
+    int index = 0;
+    bool missing = !in;
+
+    while (!missing) {
+      Chunk* chunk = new Chunk;
+      chunk->file = file;
+      chunk->index = index;
+      chunk->first_line = line;
+      chunk->text.swap(carry);
+
+      // read until the chunk holds at least one whole game, or the file ends
+      size_t cut = 0;
+      bool ended = false;
+      while ((cut == 0) && !ended) {
+        size_t size = chunk->text.size();
+        chunk->text.resize(size + chunk_bytes);
+        in.read(&chunk->text[size], chunk_bytes);
+        chunk->text.resize(size + in.gcount());
+
+        ended = (in.gcount() < static_cast<streamsize>(chunk_bytes));
+        cut = ended ? chunk->text.size() : last_game_start(chunk->text);
+      }
+
+      // the last game may run on into the next chunk
+      carry.assign(chunk->text, cut, string::npos);
+      chunk->text.resize(cut);
+      line += count(chunk->text.begin(), chunk->text.end(), '\n');
+      index++;
+
+      {
+        lock_guard<mutex> guard(lock);
+        bytes += chunk->text.size();
+      }
+      submit(pool, chunk);
+
+      if (ended)
+        break;
+    }
+
+    {
+      lock_guard<mutex> guard(lock);
+      states[file].chunks = index;
+      states[file].finished = true;
+      states[file].missing = missing;
+    }
+    changed.notify_all();
+  }
+}
+
+void ReplayPipeline::submit(ThreadPool &pool, Chunk* chunk) {
+  unique_lock<mutex> guard(lock);
+  FileState &state = states[chunk->file];
+
+  // the file being written may always queue work of its own, so writing never waits on a reader that waits on writing
+  changed.wait(guard, [this, chunk, &state] {
+    return (chunk->file == head_file) ? (state.in_flight < max_in_flight) : (in_flight < max_in_flight);
+  });
+  state.in_flight++;
+  in_flight++;
+  guard.unlock();
+
+  pool.submit([this, chunk](int worker) {
+    replay(chunk, boards[worker]);
+  });
+}
+
+void ReplayPipeline::replay(Chunk* chunk, ChessBoard &board) {
+  PgnReader reader(chunk->text.data(), chunk->text.size());
+  ChunkResult result = ChunkResult();
+  PgnGame game;
+
+  while (reader.next_game(board, game)) {
+    result.game_count++;
+    result.plies += game.plies;
+    if (game.status != PGN_OK)
+      result.failed++;
+
+    if (!errors_only || (game.status != PGN_OK)) {
+      game.line += chunk->first_line - 1;
+      result.games.push_back(game);
+    }
+  }
+
+  {
+    lock_guard<mutex> guard(lock);
+    states[chunk->file].done[chunk->index] = move(result);
+  }
+  changed.notify_all();
+  delete chunk;
+}
+
+void ReplayPipeline::write_file(int file, ostream &out, ReplayStats &stats) {
+  FileState &state = states[file];
+  uint64_t games_before = 0;
+
+  for (int index = 0; ; index++) {
+    ChunkResult result;
+    {
+      unique_lock<mutex> guard(lock);
+      changed.wait(guard, [&state, index] { return (state.done.count(index) > 0) || (state.finished && (index >= state.chunks)); });
+
+      if (state.done.count(index) == 0)
+        return;
+
+      result = move(state.done[index]);
+      state.done.erase(index);
+      state.in_flight--;
+      in_flight--;
+    }
+    changed.notify_all();
+
+    // games are numbered from the start of the file, not of the chunk
+    for (PgnGame &game : result.games) {
+      game.number += games_before;
+      if (files->size() > 1)
+        out << (*files)[file] << " ";
+      print_pgn_game(out, game);
+    }
+
+    games_before += result.game_count;
+    stats.games += result.game_count;
+    stats.failed += result.failed;
+    stats.plies += result.plies;
+  }
+}
+
+size_t ReplayPipeline::last_game_start(const string &text) {
+  size_t tagged = 0;
+
+  // a game starts with a tag at the start of a line, after a line that is not a tag
+  for (size_t start = text.rfind("\n["); (start != string::npos) && (start > 0); start = text.rfind("\n[", start - 1)) {
+    size_t previous = text.rfind('\n', start - 1);
+    previous = (previous == string::npos) ? 0 : previous + 1;
+
+    if (text[previous] != '[') {
+      tagged = start + 1;
+      break;
+    }
+  }
+
+  // games without tags start on the first line after a blank line that follows a result
+  size_t next_start = string::npos;
+  bool blank_between = false;
+  size_t end = text.size();
+
+  while (end > tagged) {
+    size_t start = (end > 0) ? text.rfind('\n', end - 1) : string::npos;
+    start = (start == string::npos) ? 0 : start + 1;
+
+    if (blank_line(text, start, end))
+      blank_between = (next_start != string::npos);
+    else {
+      if (blank_between && ends_with_result(text, start, end))
+        return max(next_start, tagged);
+      next_start = start;
+      blank_between = false;
+    }
+
+    if (start == 0)
+      break;
+    end = start - 1;
+  }
+  return tagged;
+}
@@ -0,0 +1,113 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include<condition_variable>
+#include<cstdint>
+#include<map>
+#include<mutex>
+#include<ostream>
+#include<string>
+#include<vector>
+
+#include"Pgn.h"
+
+class ChessBoard;
+class ThreadPool;
+
+/* Totals over a run of replayed games */
+struct ReplayStats {
+  uint64_t games;
+  uint64_t failed;
+  uint64_t plies;
+  uint64_t bytes;
+  double seconds;
+};
+
+/* Print the totals of stats with the games and plies replayed per second */
+void print_replay_stats(std::ostream &os, const ReplayStats &stats);
+
+/* Replays and checks the games of many PGN files at once. Reader threads cut
+   each file into chunks that end on a game boundary, a work-stealing pool
+   replays the chunks into one ChessBoard per worker, and the calling thread
+   writes the results out in file and game order. Only a bounded number of
+   chunks is held in memory at a time. */
+class ReplayPipeline {
+private:
+  /* A run of whole games read from one file */
+  struct Chunk {
+    int file;
+    int index;
+    /* Line of the file the chunk starts on */
+    uint64_t first_line;
+    std::string text;
+  };
+
+  /* The games of a chunk worth reporting, and its totals */
+  struct ChunkResult {
+    std::vector<PgnGame> games;
+    uint64_t game_count;
+    uint64_t failed;
+    uint64_t plies;
+  };
+
+  /* Progress through one input file */
+  struct FileState {
+    /* Replayed chunks waiting to be written, by index */
+    std::map<int, ChunkResult> done;
+    /* Chunks read so far, and read in total once finished */
+    int chunks;
+    int in_flight;
+    bool finished;
+    bool missing;
+  };
+
+  int thread_count;
+  int reader_count;
+  bool errors_only;
+  size_t chunk_bytes;
+  /* Chunks read but not yet written, across all files */
+  int max_in_flight;
+
+  const std::vector<std::string>* files;
+  /* The board each pool worker replays into */
+  std::vector<ChessBoard> boards;
+  std::vector<FileState> states;
+  int next_file;
+  /* The file being written */
+  int head_file;
+  int in_flight;
+  uint64_t bytes;
+  std::mutex lock;
+  std::condition_variable changed;
+
+  /* Read files, chunk them and queue the chunks on pool until every file is taken */
+  void read_files(ThreadPool &pool);
+
+  /* Queue the chunk on pool once there is room for it */
+  void submit(ThreadPool &pool, Chunk* chunk);
+
+  /* Replay the games of chunk into board, store the result and free the chunk */
+  void replay(Chunk* chunk, ChessBoard &board);
+
+  /* Write the results of file in order as they arrive, adding their totals to stats */
+  void write_file(int file, std::ostream &out, ReplayStats &stats);
+
+public:
+  /* -------------------- Constructors -------------------- */
+  /* Replay on thread_count workers fed by reader_count readers, cutting chunks of about chunk_bytes.
+     If errors_only, only the games that fail are written. */
+  ReplayPipeline(int thread_count, int reader_count, bool errors_only, size_t chunk_bytes = 1 << 20);
+  ~ReplayPipeline();
+
+  /* -------------------- Replay -------------------- */
+  /* Replay every game of files ("-" for the standard input), writing a line per game to out and
+     the totals to stats. Return false if a file could not be opened. */
+  bool run(const std::vector<std::string> &files, std::ostream &out, ReplayStats &stats);
+
+  /* Return the offset in text of the start of its last game, or 0 if text holds at most one game start.
+     A game starts at a tag line after a line that is not a tag, or on the first line after a blank
+     line that follows a result, so files without tags are cut as well. */
+  static size_t last_game_start(const std::string &text);
+};
+
+#endif
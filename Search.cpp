@@ -0,0 +1,413 @@
+#include<iostream>
+#include<cstdlib>
+#include<cstring>
+#include<thread>
+
+using namespace std;
+
+#include"Search.h"
+#include"Evaluation.h"
+
+
+/* Return score as stored in the table: mates counted from position rather than the root */
+static int score_to_table(int score, int ply) {
+  if (score >= MATE_BOUND)
+    return score + ply;
+  if (score <= -MATE_BOUND)
+    return score - ply;
+  return score;
+}
+
+/* Return a score read from the table as seen from the root, ply moves above it */
+static int score_from_table(int score, int ply) {
+  if (score >= MATE_BOUND)
+    return score - ply;
+  if (score <= -MATE_BOUND)
+    return score + ply;
+  return score;
+}
+
+
+/* -------------------- Search -------------------- */
+/* -------------------- Constructor -------------------- */
+Search::Search(const Position &position, TranspositionTable &table)
+  : position(position), table(table), table_hits(0), table_misses(0), table_collisions(0), key_count(0), root_move(NO_MOVE), nodes(0), reported_nodes(0), stopped(false),
+    thread_id(0), shared(new SearchShared) {
+  memset(history, 0, sizeof(history));
+}
+
+void Search::add_game_key(Key key) {
+  // keep the most recent keys if the game is longer than the buffer
+  if (key_count == MAX_GAME_KEYS) {
+    memmove(keys, keys + 1, (MAX_GAME_KEYS - 1) * sizeof(Key));
+    key_count--;
+  }
+  keys[key_count++] = key;
+}
+
+/* -------------------- Search -------------------- */
+SearchResult Search::run(const SearchLimits &limits) {
+  vector<unique_ptr<Search>> helpers;
+  vector<thread> threads;
+
+  this->limits = limits;
+  start = chrono::steady_clock::now();
+  thread_id = 0;
+  shared->nodes = 0;
+  table.new_search();
+
+  // helpers copy the position, game keys and move ordering, and run until told to stop
+  for (int i = 1; i < limits.threads; i++) {
+    helpers.emplace_back(new Search(*this));
+    Search &helper = *helpers.back();
+
+    helper.thread_id = i;
+    helper.limits = SearchLimits();
+    threads.emplace_back([&helper] { helper.iterate(); });
+  }
+
+  SearchResult result = iterate();
+
+  shared->stop = true;
+  for (thread &t : threads)
+    t.join();
+
+  // the flag is only cleared once this search is over, so a stop made before it started is not lost
+  shared->stop = false;
+
+  result.thread_nodes.push_back(nodes);
+  for (unique_ptr<Search> &helper : helpers)
+    result.thread_nodes.push_back(helper->nodes);
+  result.nodes = shared->nodes;
+  result.seconds = elapsed_ms() / 1000.0;
+  return result;
+}
+
+SearchResult Search::iterate() {
+  SearchResult result;
+  MoveList root_moves;
+
+  nodes = 0;
+  reported_nodes = 0;
+  stopped = false;
+  memset(killers, 0, sizeof(killers));
+  memset(pv_length, 0, sizeof(pv_length));
+  table_hits = 0;
+  table_misses = 0;
+  table_collisions = 0;
+
+  position.generate_legal_moves(root_moves);
+  if (root_moves.empty()) {
+    result.score = position.checkers() ? -MATE : 0;
+    return result;
+  }
+
+  // always have a move to return, even if the first iteration is cut short
+  result.best_move = root_moves[0];
+  root_move = NO_MOVE;
+
+  int max_depth = (limits.depth > 0) ? min(limits.depth, MAX_PLY - 1) : MAX_PLY - 1;
+
+  // half the helpers start a ply deeper so the threads spread over different depths
+  for (int depth = 1 + (thread_id & 1); depth <= max_depth; depth++) {
+    int score = alpha_beta(depth, 0, -MATE, MATE);
+
+    // an unfinished iteration cannot be trusted
+    if (stopped)
+      break;
+
+    result.best_move = pv[0][0];
+    root_move = pv[0][0];
+    result.score = score;
+    result.depth = depth;
+    result.pv.assign(pv[0], pv[0] + pv_length[0]);
+    result.nodes = shared->nodes + (nodes - reported_nodes);
+    result.seconds = elapsed_ms() / 1000.0;
+
+    if (limits.print_info)
+      print_info(result);
+
+    // a forced mate will not improve, and a new iteration would not finish in the time left
+    if (abs(score) >= MATE_BOUND)
+      break;
+    if ((limits.time_ms > 0) && (elapsed_ms() * 2 > limits.time_ms))
+      break;
+  }
+
+  shared->nodes += nodes - reported_nodes;
+  reported_nodes = nodes;
+  table.add_stats(table_hits, table_misses, table_collisions);
+  return result;
+}
+
+int Search::alpha_beta(int depth, int ply, int alpha, int beta) {
+  pv_length[ply] = ply;
+
+  if (depth <= 0)
+    return quiescence(ply, alpha, beta);
+
+  nodes++;
+  if ((nodes & 2047) == 0)
+    check_limits();
+  if (stopped)
+    return 0;
+
+  if ((ply > 0) && ((position.halfmoves() >= 100) || repetition()))
+    return 0;
+  if (ply >= MAX_PLY - 1)
+    return evaluate(position);
+
+  bool in_check = position.checkers() != 0;
+  MoveList moves;
+  int scores[256];
+  TTEntry entry;
+  Move table_move = NO_MOVE;
+  int original_alpha = alpha;
+
+  // look further along lines that give check
+  if (in_check)
+    depth++;
+
+  if (table.probe(position.hash(), entry)) {
+    table_hits++;
+    table_move = entry.move;
+
+    // a deep enough result ends the search here, except on the principal variation
+    if ((ply > 0) && (beta - alpha == 1) && (entry.depth >= depth)) {
+      int score = score_from_table(entry.score, ply);
+
+      if ((entry.bound == BOUND_EXACT) ||
+          ((entry.bound == BOUND_LOWER) && (score >= beta)) ||
+          ((entry.bound == BOUND_UPPER) && (score <= alpha)))
+        return score;
+    }
+  }
+  else
+    table_misses++;
+
+  position.generate_legal_moves(moves);
+  if (moves.empty())
+    return in_check ? -MATE + ply : 0;
+
+  // the root searches the previous iteration's best move first, whether or not its table entry survived
+  if ((ply == 0) && (root_move != NO_MOVE))
+    table_move = root_move;
+
+  score_moves(moves, scores, table_move, ply);
+  int best = -MATE;
+  Move best_move = NO_MOVE;
+
+  for (int i = 0; i < moves.size(); i++) {
+    pick_move(moves, scores, i);
+    Move move = moves[i];
+    bool quiet = (position.piece_on(move_to(move)) == NO_PIECE) && (move_flag(move) == NORMAL || move_flag(move) == CASTLING);
+    Undo undo;
+    int score;
+
+    play(move, undo);
+
+    // the first move gets the full window, the rest must prove they are better
+    if (i == 0)
+      score = -alpha_beta(depth - 1, ply + 1, -beta, -alpha);
+    else {
+      score = -alpha_beta(depth - 1, ply + 1, -alpha - 1, -alpha);
+      if ((score > alpha) && (score < beta))
+        score = -alpha_beta(depth - 1, ply + 1, -beta, -alpha);
+    }
+
+    take_back(move, undo);
+
+    if (stopped)
+      return 0;
+
+    if (score > best) {
+      best = score;
+      best_move = move;
+
+      if (score > alpha) {
+        alpha = score;
+
+        pv[ply][ply] = move;
+        for (int j = ply + 1; j < pv_length[ply + 1]; j++)
+          pv[ply][j] = pv[ply + 1][j];
+        pv_length[ply] = max(pv_length[ply + 1], ply + 1);
+
+        if (alpha >= beta) {
+          if (quiet) {
+            if (killers[ply][0] != move) {
+              killers[ply][1] = killers[ply][0];
+              killers[ply][0] = move;
+            }
+            history[move_from(move)][move_to(move)] += depth * depth;
+          }
+          break;
+        }
+      }
+    }
+  }
+
+  int bound = (best >= beta) ? BOUND_LOWER : (best > original_alpha) ? BOUND_EXACT : BOUND_UPPER;
+
+  if (table.store(position.hash(), (bound == BOUND_UPPER) ? NO_MOVE : best_move, score_to_table(best, ply), depth, bound))
+    table_collisions++;
+  return best;
+}
+
+int Search::quiescence(int ply, int alpha, int beta) {
+  pv_length[ply] = ply;
+
+  nodes++;
+  if ((nodes & 2047) == 0)
+    check_limits();
+  if (stopped)
+    return 0;
+
+  if (ply >= MAX_PLY - 1)
+    return evaluate(position);
+
+  bool in_check = position.checkers() != 0;
+  MoveList moves;
+  int scores[256];
+  int best = -MATE + ply;
+
+  position.generate_legal_moves(moves);
+  if (moves.empty())
+    return in_check ? -MATE + ply : 0;
+
+  // out of check the side to move may stop capturing
+  if (!in_check) {
+    best = evaluate(position);
+    if (best >= beta)
+      return best;
+    if (best > alpha)
+      alpha = best;
+  }
+
+  score_moves(moves, scores, NO_MOVE, ply);
+
+  for (int i = 0; i < moves.size(); i++) {
+    pick_move(moves, scores, i);
+    Move move = moves[i];
+
+    // only captures and promotions, unless every move must be tried to escape check
+    if (!in_check && (position.piece_on(move_to(move)) == NO_PIECE) && (move_flag(move) != EN_PASSANT) && (move_flag(move) != PROMOTION))
+      continue;
+
+    Undo undo;
+    play(move, undo);
+    int score = -quiescence(ply + 1, -beta, -alpha);
+    take_back(move, undo);
+
+    if (stopped)
+      return 0;
+
+    if (score > best) {
+      best = score;
+      if (score > alpha) {
+        alpha = score;
+        if (alpha >= beta)
+          break;
+      }
+    }
+  }
+
+  return best;
+}
+
+/* -------------------- Helpers -------------------- */
+void Search::score_moves(const MoveList &moves, int scores[], Move pv_move, int ply) {
+  for (int i = 0; i < moves.size(); i++) {
+    Move move = moves[i];
+    int victim = position.piece_on(move_to(move));
+
+    if (move == pv_move)
+      scores[i] = 1000000;
+    else if (victim != NO_PIECE)
+      // most valuable victim first, then least valuable attacker
+      scores[i] = 100000 + 10 * piece_values[piece_type(victim)] - piece_type(position.piece_on(move_from(move)));
+    else if (move_flag(move) == PROMOTION)
+      scores[i] = 95000 + piece_values[promotion_type(move)];
+    else if (move_flag(move) == EN_PASSANT)
+      scores[i] = 100000 + 10 * piece_values[PAWN];
+    else if (move == killers[ply][0])
+      scores[i] = 90000;
+    else if (move == killers[ply][1])
+      scores[i] = 80000;
+    else
+      scores[i] = min(history[move_from(move)][move_to(move)], 70000);
+  }
+}
+
+void Search::pick_move(MoveList &moves, int scores[], int index) {
+  int best = index;
+
+  for (int i = index + 1; i < moves.size(); i++) {
+    if (scores[i] > scores[best])
+      best = i;
+  }
+
+  swap(moves.moves[index], moves.moves[best]);
+  swap(scores[index], scores[best]);
+}
+
+bool Search::repetition() {
+  Key key = position.hash();
+  int oldest = max(0, key_count - position.halfmoves());
+
+  // only positions with the same side to move can repeat
+  for (int i = key_count - 2; i >= oldest; i -= 2) {
+    if (keys[i] == key)
+      return true;
+  }
+  return false;
+}
+
+void Search::play(Move move, Undo &undo) {
+  keys[key_count++] = position.hash();
+  position.do_move(move, undo);
+}
+
+void Search::take_back(Move move, const Undo &undo) {
+  position.undo_move(move, undo);
+  key_count--;
+}
+
+void Search::check_limits() {
+  shared->nodes.fetch_add(nodes - reported_nodes, memory_order_relaxed);
+  reported_nodes = nodes;
+
+  if (shared->stop.load(memory_order_relaxed))
+    stopped = true;
+
+  // only the reporting thread enforces the limits, and then stops the helpers
+  if (thread_id != 0)
+    return;
+
+  if ((limits.nodes > 0) && (shared->nodes.load(memory_order_relaxed) >= limits.nodes))
+    stopped = true;
+  if ((limits.time_ms > 0) && (elapsed_ms() >= limits.time_ms))
+    stopped = true;
+
+  if (stopped)
+    shared->stop = true;
+}
+
+int64_t Search::elapsed_ms() {
+  return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+}
+
+void Search::print_info(const SearchResult &result) {
+  int64_t time_ms = elapsed_ms();
+
+  cout << "info depth " << result.depth << " score ";
+  if (abs(result.score) >= MATE_BOUND)
+    cout << "mate " << ((result.score > 0) ? (MATE - result.score + 1) / 2 : -(MATE + result.score) / 2);
+  else
+    cout << "cp " << result.score;
+
+  cout << " nodes " << result.nodes << " nps " << ((time_ms > 0) ? result.nodes * 1000 / time_ms : result.nodes)
+       << " time " << time_ms << " hashfull " << table.stats().fill << " pv";
+  for (Move move : result.pv)
+    cout << " " << move_to_uci(move);
+  cout << endl;
+}
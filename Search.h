@@ -0,0 +1,144 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include<atomic>
+#include<chrono>
+#include<cstdint>
+#include<memory>
+#include<vector>
+
+#include"Position.h"
+#include"TranspositionTable.h"
+
+/* Scores at or beyond MATE_BOUND in magnitude are forced mates */
+const int MATE = 32000;
+const int MATE_BOUND = MATE - 1000;
+
+/* When to stop searching. A zero field means no limit of that kind. */
+struct SearchLimits {
+  int depth;
+  int64_t time_ms;
+  uint64_t nodes;
+  /* Print a line for every completed iteration */
+  bool print_info;
+  /* Threads searching the position together, sharing the transposition table */
+  int threads;
+
+  SearchLimits() : depth(0), time_ms(0), nodes(0), print_info(false), threads(1) {}
+};
+
+/* The outcome of the deepest completed iteration */
+struct SearchResult {
+  Move best_move;
+  int score;
+  int depth;
+  uint64_t nodes;
+  double seconds;
+  std::vector<Move> pv;
+  /* Nodes searched by each thread, the reporting thread first */
+  std::vector<uint64_t> thread_nodes;
+
+  SearchResult() : best_move(NO_MOVE), score(0), depth(0), nodes(0), seconds(0) {}
+};
+
+/* State shared by every thread of one search */
+struct SearchShared {
+  std::atomic<bool> stop;
+  /* Nodes searched by all threads, added to in batches */
+  std::atomic<uint64_t> nodes;
+
+  SearchShared() : stop(false), nodes(0) {}
+};
+
+/* Principal variation alpha-beta search with iterative deepening. With more
+   than one thread the search is Lazy SMP: helper threads search their own
+   copies of the position and share results only through the table. */
+class Search {
+private:
+  static const int MAX_PLY = 128;
+  static const int MAX_GAME_KEYS = 1024;
+
+  Position position;
+  /* Results shared with other searches */
+  TranspositionTable &table;
+  /* Table probes of this search, added to the table's counters when it ends */
+  uint64_t table_hits;
+  uint64_t table_misses;
+  uint64_t table_collisions;
+
+  /* Keys of earlier positions, for repetition detection */
+  Key keys[MAX_GAME_KEYS + MAX_PLY];
+  int key_count;
+
+  /* Principal variation found below each ply */
+  Move pv[MAX_PLY][MAX_PLY];
+  int pv_length[MAX_PLY];
+
+  /* Best move of the last completed iteration, searched first at the root */
+  Move root_move;
+
+  /* Quiet moves that caused a cutoff at each ply */
+  Move killers[MAX_PLY][2];
+  /* Cutoff history of quiet moves by source and destination */
+  int history[64][64];
+
+  SearchLimits limits;
+  std::chrono::steady_clock::time_point start;
+  uint64_t nodes;
+  /* Part of nodes already added to the shared count */
+  uint64_t reported_nodes;
+  bool stopped;
+  /* 0 for the thread that reports results, 1 up for helpers */
+  int thread_id;
+  std::shared_ptr<SearchShared> shared;
+
+  /* Deepen the search until stopped and return the deepest completed iteration */
+  SearchResult iterate();
+
+  /* Return the score of position searched depth plies deep within the window alpha to beta */
+  int alpha_beta(int depth, int ply, int alpha, int beta);
+
+  /* Return the score of position once captures have been played out */
+  int quiescence(int ply, int alpha, int beta);
+
+  /* Give each move an ordering score, best first */
+  void score_moves(const MoveList &moves, int scores[], Move pv_move, int ply);
+
+  /* Swap the best scoring move from index onward into index */
+  void pick_move(MoveList &moves, int scores[], int index);
+
+  /* Return true if the current position repeats an earlier one */
+  bool repetition();
+
+  /* Play move, recording the key it leaves */
+  void play(Move move, Undo &undo);
+
+  /* Take back move */
+  void take_back(Move move, const Undo &undo);
+
+  /* Report nodes searched and set stopped if a limit has been reached or the search was stopped */
+  void check_limits();
+
+  /* Return the milliseconds since the search started */
+  int64_t elapsed_ms();
+
+  /* Print the result of a completed iteration */
+  void print_info(const SearchResult &result);
+
+public:
+  /* -------------------- Constructors -------------------- */
+  Search(const Position &position, TranspositionTable &table);
+
+  /* Record the key of a position played before the one to search, oldest first */
+  void add_game_key(Key key);
+
+  /* -------------------- Search -------------------- */
+  /* Search on limits.threads threads until a limit is reached and return the best move found.
+     The node count of the result covers every thread. */
+  SearchResult run(const SearchLimits &limits);
+
+  /* Stop a search running on another thread as soon as possible. If called before run, the next run stops at once. */
+  void stop() { shared->stop = true; }
+};
+
+#endif
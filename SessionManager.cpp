@@ -0,0 +1,440 @@
+#include<algorithm>
+#include<chrono>
+#include<condition_variable>
+#include<iostream>
+#include<mutex>
+#include<thread>
+
+using namespace std;
+
+#include"SessionManager.h"
+#include"ChessBoard.h"
+#include"EventLog.h"
+
+
+/* What a request asks of its shard */
+enum RequestType { REQUEST_NEW_GAME, REQUEST_MOVE, REQUEST_END_GAME };
+
+/* The position every game starts from, as the pool sets it up and the load generator's clients mirror it */
+static const char start_fen[] = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+
+/* -------------------- LatencyHistogram -------------------- */
+/* -------------------- Constructors -------------------- */
+LatencyHistogram::LatencyHistogram() : total(0), largest(0) {
+  for (int i = 0; i < BUCKETS; i++)
+    counts[i].store(0, memory_order_relaxed);
+}
+
+/* -------------------- Counts -------------------- */
+void LatencyHistogram::record(uint64_t nanoseconds) {
+  atomic<uint64_t> &count = counts[bucket(nanoseconds)];
+
+  // the only writer, so plain loads and stores are enough and cost no locked instructions
+  count.store(count.load(memory_order_relaxed) + 1, memory_order_relaxed);
+  total.store(total.load(memory_order_relaxed) + 1, memory_order_relaxed);
+  if (nanoseconds > largest.load(memory_order_relaxed))
+    largest.store(nanoseconds, memory_order_relaxed);
+}
+
+void LatencyHistogram::add(const LatencyHistogram &other) {
+  for (int i = 0; i < BUCKETS; i++)
+    counts[i].store(counts[i].load(memory_order_relaxed) + other.counts[i].load(memory_order_relaxed), memory_order_relaxed);
+  total.store(total.load(memory_order_relaxed) + other.count(), memory_order_relaxed);
+  largest.store(std::max(max(), other.max()), memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::percentile(double fraction) const {
+  uint64_t wanted = static_cast<uint64_t>(fraction * count());
+  uint64_t seen = 0;
+
+  for (int i = 0; i < BUCKETS; i++) {
+    seen += counts[i].load(memory_order_relaxed);
+    if (seen > wanted)
+      return std::min(bucket_limit(i), max());
+  }
+  return max();
+}
+
+/* -------------------- Helpers -------------------- */
+int LatencyHistogram::bucket(uint64_t nanoseconds) {
+  if (nanoseconds < SUB_BUCKETS)
+    return static_cast<int>(nanoseconds);
+
+  // the power of two, then the next three bits below it
+  int power = 63 - __builtin_clzll(nanoseconds);
+  return (power - 2) * SUB_BUCKETS + static_cast<int>((nanoseconds >> (power - 3)) & (SUB_BUCKETS - 1));
+}
+
+uint64_t LatencyHistogram::bucket_limit(int bucket) {
+  if (bucket < SUB_BUCKETS)
+    return bucket;
+
+  int power = bucket / SUB_BUCKETS + 2;
+  uint64_t lowest = static_cast<uint64_t>(SUB_BUCKETS + bucket % SUB_BUCKETS) << (power - 3);
+  return lowest + (1ULL << (power - 3)) - 1;
+}
+
+void print_latency(ostream &os, const LatencyHistogram &histogram) {
+  os << histogram.count() << " requests, latency p50 " << histogram.percentile(0.5) / 1000.0 << " us, p90 "
+     << histogram.percentile(0.9) / 1000.0 << " us, p99 " << histogram.percentile(0.99) / 1000.0 << " us, p99.9 "
+     << histogram.percentile(0.999) / 1000.0 << " us, max " << histogram.max() / 1000.0 << " us" << endl;
+}
+
+
+/* -------------------- GamePool -------------------- */
+/* -------------------- Constructors -------------------- */
+GamePool::GamePool() {
+  start.set_fen(start_fen);
+}
+
+/* -------------------- Boards -------------------- */
+uint32_t GamePool::allocate() {
+  uint32_t slot;
+
+  if (!free_slots.empty()) {
+    slot = free_slots.back();
+    free_slots.pop_back();
+  }
+  else {
+    slot = generations.size();
+    if (slot % BLOCK_SIZE == 0)
+      blocks.emplace_back(new Position[BLOCK_SIZE]);
+    generations.push_back(0);
+  }
+
+  blocks[slot / BLOCK_SIZE][slot % BLOCK_SIZE] = start;
+  generations[slot]++;
+  return slot;
+}
+
+void GamePool::release(uint32_t slot) {
+  generations[slot]++;
+  free_slots.push_back(slot);
+}
+
+Position* GamePool::find(uint32_t slot, uint32_t generation) {
+  if ((slot >= generations.size()) || (generations[slot] != generation) || !(generation & 1))
+    return NULL;
+  return &blocks[slot / BLOCK_SIZE][slot % BLOCK_SIZE];
+}
+
+
+/* -------------------- SessionManager -------------------- */
+struct SessionManager::Request {
+  RequestType type;
+  GameId game;
+  Square from;
+  Square to;
+  chrono::steady_clock::time_point made;
+  ReplyCallback done;
+};
+
+struct SessionManager::Shard {
+  int index;
+  mutex lock;
+  condition_variable ready;
+  condition_variable idle;
+  /* Requests waiting for the worker, and counts of those made and answered */
+  vector<Request> queue;
+  uint64_t made;
+  uint64_t answered;
+  bool stopping;
+
+  /* Only the worker touches the pool and board */
+  GamePool pool;
+  ChessBoard board;
+  LatencyHistogram latency;
+  atomic<uint64_t> live_games;
+  atomic<uint64_t> pooled_boards;
+  thread worker;
+
+  explicit Shard(int index) : index(index), made(0), answered(0), stopping(false), board(true), live_games(0), pooled_boards(0) {}
+};
+
+/* -------------------- Constructors -------------------- */
+SessionManager::SessionManager(int shard_count, EventLog* log) : next_shard(0), events(log) {
+  for (int i = 0; i < std::max(shard_count, 1); i++)
+    shards.emplace_back(new Shard(i));
+  for (unique_ptr<Shard> &shard : shards)
+    shard->worker = thread(&SessionManager::run, this, ref(*shard));
+}
+
+SessionManager::~SessionManager() {
+  for (unique_ptr<Shard> &shard : shards) {
+    {
+      lock_guard<mutex> guard(shard->lock);
+      shard->stopping = true;
+    }
+    shard->ready.notify_one();
+  }
+
+  for (unique_ptr<Shard> &shard : shards)
+    shard->worker.join();
+}
+
+/* -------------------- Requests -------------------- */
+void SessionManager::new_game(ReplyCallback done) {
+  Request request = {REQUEST_NEW_GAME, 0, Square(), Square(), chrono::steady_clock::time_point(), move(done)};
+
+  submit(*shards[next_shard.fetch_add(1, memory_order_relaxed) % shards.size()], request);
+}
+
+void SessionManager::submit_move(GameId game, Square from_square, Square to_square, ReplyCallback done) {
+  Request request = {REQUEST_MOVE, game, from_square, to_square, chrono::steady_clock::time_point(), move(done)};
+
+  submit(*shards[static_cast<uint32_t>(game) % shards.size()], request);
+}
+
+void SessionManager::submitMove(GameId game, const char from[], const char to[], ReplyCallback done) {
+  submit_move(game, Point(from).to_square(), Point(to).to_square(), move(done));
+}
+
+void SessionManager::end_game(GameId game, ReplyCallback done) {
+  Request request = {REQUEST_END_GAME, game, Square(), Square(), chrono::steady_clock::time_point(), move(done)};
+
+  submit(*shards[static_cast<uint32_t>(game) % shards.size()], request);
+}
+
+void SessionManager::drain() {
+  for (unique_ptr<Shard> &shard : shards) {
+    unique_lock<mutex> guard(shard->lock);
+    shard->idle.wait(guard, [&shard] { return shard->answered == shard->made; });
+  }
+}
+
+/* -------------------- Statistics -------------------- */
+const LatencyHistogram& SessionManager::latency(int shard) const {
+  return shards[shard]->latency;
+}
+
+uint64_t SessionManager::live_games(int shard) const {
+  return shards[shard]->live_games.load(memory_order_relaxed);
+}
+
+uint64_t SessionManager::pooled_boards(int shard) const {
+  return shards[shard]->pooled_boards.load(memory_order_relaxed);
+}
+
+/* -------------------- Helpers -------------------- */
+void SessionManager::submit(Shard &shard, Request &request) {
+  bool was_empty;
+
+  request.made = chrono::steady_clock::now();
+  {
+    lock_guard<mutex> guard(shard.lock);
+    was_empty = shard.queue.empty();
+    shard.queue.push_back(move(request));
+    shard.made++;
+  }
+
+  // the worker only sleeps on an empty queue
+  if (was_empty)
+    shard.ready.notify_one();
+}
+
+void SessionManager::run(Shard &shard) {
+  vector<Request> batch;
+
+  for (;;) {
+    {
+      unique_lock<mutex> guard(shard.lock);
+      shard.ready.wait(guard, [&shard] { return !shard.queue.empty() || shard.stopping; });
+      if (shard.queue.empty())
+        return;
+      batch.swap(shard.queue);
+    }
+
+    // the whole queue is taken at once, so callers add to an empty one while the batch is handled
+    for (Request &request : batch)
+      handle(shard, request);
+
+    bool all_answered;
+    {
+      lock_guard<mutex> guard(shard.lock);
+      shard.answered += batch.size();
+      all_answered = (shard.answered == shard.made);
+    }
+    if (all_answered)
+      shard.idle.notify_all();
+    batch.clear();
+  }
+}
+
+void SessionManager::handle(Shard &shard, Request &request) {
+  uint32_t slot = static_cast<uint32_t>(request.game) / shards.size();
+  uint32_t generation = static_cast<uint32_t>(request.game >> 32);
+  SessionReply reply = {request.game, true, NULL};
+  MoveResult result;
+  Position* game;
+  int ply;
+
+  switch (request.type) {
+    case REQUEST_NEW_GAME:
+      slot = shard.pool.allocate();
+      reply.game = (static_cast<GameId>(shard.pool.generation(slot)) << 32) | (slot * shards.size() + shard.index);
+      if (events)
+        events->new_game(static_cast<uint32_t>(reply.game));
+      shard.live_games.store(shard.live_games.load(memory_order_relaxed) + 1, memory_order_relaxed);
+      shard.pooled_boards.store(shard.pool.capacity(), memory_order_relaxed);
+      break;
+
+    case REQUEST_MOVE:
+      game = shard.pool.find(slot, generation);
+      if (game) {
+        // every game starts from the usual position, so the ply follows from the move number
+        ply = 2 * (game->fullmoves() - 1) + game->side();
+        shard.board.set_position(*game);
+        result = shard.board.submit_move(request.from, request.to);
+        *game = shard.board.get_position();
+        reply.result = &result;
+
+        if (events)
+          events->move(static_cast<uint32_t>(request.game), ply, result);
+      }
+      reply.found = (game != NULL);
+      break;
+
+    case REQUEST_END_GAME:
+      game = shard.pool.find(slot, generation);
+      if (game) {
+        shard.pool.release(slot);
+        shard.live_games.store(shard.live_games.load(memory_order_relaxed) - 1, memory_order_relaxed);
+      }
+      reply.found = (game != NULL);
+      break;
+  }
+
+  shard.latency.record(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - request.made).count());
+  if (request.done)
+    request.done(reply);
+}
+
+
+/* -------------------- Load generator -------------------- */
+/* One client thread of a load test and the games it keeps going */
+struct LoadClient {
+  struct Game {
+    GameId id;
+    /* The client's copy of the game, to choose moves from */
+    Position position;
+    int plies;
+  };
+
+  vector<Game> games;
+  LoadStats stats;
+  mutex lock;
+  condition_variable replied;
+  int outstanding;
+
+  /* Note a reply, waking the client once every request is answered */
+  void answered(bool rejected) {
+    lock_guard<mutex> guard(lock);
+    if (rejected)
+      stats.rejected++;
+    if (--outstanding == 0)
+      replied.notify_one();
+  }
+
+  /* Block until every request made has been answered */
+  void wait() {
+    unique_lock<mutex> guard(lock);
+    replied.wait(guard, [this] { return outstanding == 0; });
+  }
+
+  /* Start game number on manager */
+  void start_game(SessionManager &manager, int number) {
+    games[number].position.set_fen(start_fen);
+    games[number].plies = 0;
+    stats.games++;
+    stats.requests++;
+    manager.new_game([this, number](const SessionReply &reply) {
+      games[number].id = reply.game;
+      answered(false);
+    });
+  }
+
+  /* Play load on manager until seconds have passed */
+  void play(SessionManager &manager, int game_count, double seconds, Key seed) {
+    const int MAX_PLIES = 200;
+    auto start = chrono::steady_clock::now();
+    Key random = seed;
+
+    games.resize(game_count);
+    stats = LoadStats();
+    {
+      lock_guard<mutex> guard(lock);
+      outstanding = game_count;
+    }
+    for (int i = 0; i < game_count; i++)
+      start_game(manager, i);
+    wait();
+
+    while (chrono::duration<double>(chrono::steady_clock::now() - start).count() < seconds) {
+      {
+        lock_guard<mutex> guard(lock);
+        outstanding = game_count;
+      }
+
+      for (int i = 0; i < game_count; i++) {
+        Game &game = games[i];
+        MoveList moves;
+        MoveList submittable;
+
+        // submitMove takes a piece from one square to another, so castling and en passant are left out and pawns become queens
+        game.position.generate_legal_moves(moves);
+        for (Move move : moves) {
+          if ((move_flag(move) == NORMAL) || ((move_flag(move) == PROMOTION) && (promotion_type(move) == QUEEN)))
+            submittable.add(move);
+        }
+
+        if (submittable.empty() || (game.plies >= MAX_PLIES)) {
+          {
+            // replies to this round may already be arriving
+            lock_guard<mutex> guard(lock);
+            outstanding++;
+          }
+          stats.requests++;
+          manager.end_game(game.id, [this](const SessionReply &reply) {
+            answered(!reply.found);
+          });
+          start_game(manager, i);
+        }
+        else {
+          Move move = submittable[next_random(random) % submittable.size()];
+          Undo undo;
+
+          game.position.do_move(move, undo);
+          game.plies++;
+          stats.moves++;
+          stats.requests++;
+          manager.submit_move(game.id, Square(move_from(move)), Square(move_to(move)), [this](const SessionReply &reply) {
+            answered(!reply.found || (reply.result->status != MOVE_PLAYED));
+          });
+        }
+      }
+      wait();
+    }
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  }
+};
+
+void run_load(SessionManager &manager, int client_count, int games_per_client, double seconds, LoadStats &stats) {
+  vector<unique_ptr<LoadClient>> clients;
+  vector<thread> threads;
+
+  for (int i = 0; i < std::max(client_count, 1); i++) {
+    clients.emplace_back(new LoadClient);
+    threads.emplace_back(&LoadClient::play, clients.back().get(), ref(manager), std::max(games_per_client, 1), seconds, 0x9E3779B97F4A7C15ULL * (i + 1));
+  }
+
+  stats = LoadStats();
+  for (size_t i = 0; i < threads.size(); i++) {
+    threads[i].join();
+    stats.requests += clients[i]->stats.requests;
+    stats.moves += clients[i]->stats.moves;
+    stats.games += clients[i]->stats.games;
+    stats.rejected += clients[i]->stats.rejected;
+    stats.seconds = std::max(stats.seconds, clients[i]->stats.seconds);
+  }
+}
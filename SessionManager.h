@@ -0,0 +1,197 @@
+#ifndef SESSIONMANAGER_H
+#define SESSIONMANAGER_H
+
+#include<atomic>
+#include<cstdint>
+#include<functional>
+#include<memory>
+#include<ostream>
+#include<vector>
+
+#include"Position.h"
+#include"Square.h"
+
+class EventLog;
+struct MoveResult;
+
+/* Names a game of a SessionManager: the generation of its board in the high
+   32 bits, so a game that has ended is never mistaken for the next one to use
+   the board, and the board's slot and shard in the low 32 bits */
+typedef uint64_t GameId;
+
+/* The answer to a request, handed to its callback on the thread of the shard that handled it */
+struct SessionReply {
+  GameId game;
+  /* False if the game has ended or never existed */
+  bool found;
+  /* The outcome of a move, or NULL for other requests */
+  const MoveResult* result;
+};
+
+typedef std::function<void(const SessionReply &reply)> ReplyCallback;
+
+/* Counts of latencies in buckets an eighth of a power of two wide, so any
+   percentile is within about 12% of the truth. Written by one thread; others
+   may read it at any time, seeing counts at most a little behind. */
+class LatencyHistogram {
+private:
+  static const int SUB_BUCKETS = 8;
+  static const int BUCKETS = 62 * SUB_BUCKETS;
+
+  std::atomic<uint64_t> counts[BUCKETS];
+  std::atomic<uint64_t> total;
+  std::atomic<uint64_t> largest;
+
+  /* Return the bucket counting a latency of nanoseconds */
+  static int bucket(uint64_t nanoseconds);
+
+  /* Return the largest latency counted in bucket */
+  static uint64_t bucket_limit(int bucket);
+
+public:
+  /* -------------------- Constructors -------------------- */
+  LatencyHistogram();
+
+  /* -------------------- Counts -------------------- */
+  /* Count one latency of nanoseconds. Only one thread may record into a histogram. */
+  void record(uint64_t nanoseconds);
+
+  /* Add the counts of other */
+  void add(const LatencyHistogram &other);
+
+  /* Return the number of latencies counted */
+  uint64_t count() const { return total.load(std::memory_order_relaxed); }
+
+  /* Return the largest latency counted, in nanoseconds */
+  uint64_t max() const { return largest.load(std::memory_order_relaxed); }
+
+  /* Return the latency in nanoseconds that fraction of those counted did not exceed */
+  uint64_t percentile(double fraction) const;
+};
+
+/* Print the count and percentiles of histogram in microseconds */
+void print_latency(std::ostream &os, const LatencyHistogram &histogram);
+
+/* The boards of one shard's games. Sessions never take moves back, so a game is
+   kept as a bare Position rather than a ChessBoard and its history. Positions are
+   allocated BLOCK_SIZE at a time, never move, and are reused once their game
+   ends, so once the pool has grown to the most games live at once, starting a
+   game allocates nothing. */
+class GamePool {
+private:
+  static const int BLOCK_SIZE = 1024;
+
+  std::vector<std::unique_ptr<Position[]>> blocks;
+  /* Generation of each slot's board, odd while a game is using it */
+  std::vector<uint32_t> generations;
+  std::vector<uint32_t> free_slots;
+  /* The position every game starts from */
+  Position start;
+
+public:
+  /* -------------------- Constructors -------------------- */
+  GamePool();
+  GamePool(const GamePool&) = delete;
+  GamePool& operator=(const GamePool&) = delete;
+
+  /* -------------------- Boards -------------------- */
+  /* Take a board for a new game, set to the starting position. Return its slot. */
+  uint32_t allocate();
+
+  /* Give back the board in slot once its game has ended */
+  void release(uint32_t slot);
+
+  /* Return the board in slot if its game is still of generation, otherwise NULL */
+  Position* find(uint32_t slot, uint32_t generation);
+
+  /* Return the generation of the board in slot */
+  uint32_t generation(uint32_t slot) const { return generations[slot]; }
+
+  /* Return the number of boards allocated, in use or not */
+  size_t capacity() const { return generations.size(); }
+};
+
+/* Plays many games at once for callers on any thread. Each game belongs to
+   one of a fixed set of shards, and each shard has its own worker thread,
+   request queue, pool of boards and latency histogram. Moves are played on
+   one ChessBoard per shard, loaded with the game's position for each move. A request only ever
+   takes the lock of its own shard's queue, so callers routing to different
+   shards never wait on each other, and a game's requests are handled in the
+   order they were made. */
+class SessionManager {
+private:
+  struct Request;
+  struct Shard;
+
+  std::vector<std::unique_ptr<Shard>> shards;
+  /* Shard of the next new game */
+  std::atomic<unsigned> next_shard;
+  /* Where games and moves are recorded, if anywhere */
+  EventLog* events;
+
+  /* Queue request on shard */
+  void submit(Shard &shard, Request &request);
+
+  /* Handle requests on shard until the manager is destroyed */
+  void run(Shard &shard);
+
+  /* Carry out request on shard and answer it */
+  void handle(Shard &shard, Request &request);
+
+public:
+  /* -------------------- Constructors -------------------- */
+  /* Play games on shard_count shards, recording every new game and move in log if given.
+     Games are logged under the low 32 bits of their id. */
+  explicit SessionManager(int shard_count, EventLog* log = NULL);
+
+  /* Finish every request already made, then stop the workers */
+  ~SessionManager();
+  SessionManager(const SessionManager&) = delete;
+  SessionManager& operator=(const SessionManager&) = delete;
+
+  /* -------------------- Requests -------------------- */
+  /* Start a new game on the next shard in turn, answering with its id */
+  void new_game(ReplyCallback done);
+
+  /* Play a move in game and answer with the outcome, as ChessBoard::submit_move */
+  void submit_move(GameId game, Square from_square, Square to_square, ReplyCallback done);
+
+  /* Play a move given as text such as E2 and E4 in game, as ChessBoard::submitMove does quietly */
+  void submitMove(GameId game, const char from[], const char to[], ReplyCallback done);
+
+  /* End game and free its board */
+  void end_game(GameId game, ReplyCallback done);
+
+  /* Block until every request made so far has been answered */
+  void drain();
+
+  /* -------------------- Statistics -------------------- */
+  /* Return the number of shards */
+  int shard_count() const { return shards.size(); }
+
+  /* Return the latencies of the requests shard has answered, from being made to being answered */
+  const LatencyHistogram& latency(int shard) const;
+
+  /* Return the number of games in progress on shard */
+  uint64_t live_games(int shard) const;
+
+  /* Return the number of boards shard has allocated */
+  uint64_t pooled_boards(int shard) const;
+};
+
+/* Totals of a load test */
+struct LoadStats {
+  uint64_t requests;
+  uint64_t moves;
+  uint64_t games;
+  /* Moves the manager refused, which should never happen */
+  uint64_t rejected;
+  double seconds;
+};
+
+/* Drive manager from client_count threads for about seconds, each keeping games_per_client games going with
+   one request in flight per game. Clients mirror their games to choose random legal moves, each
+   starting a new game once its game has ended or reached 200 plies, and count the totals in stats. */
+void run_load(SessionManager &manager, int client_count, int games_per_client, double seconds, LoadStats &stats);
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef SQUARE_H
+#define SQUARE_H
+
+#include<cstdint>
+#include<ostream>
+
+#include"Bitboard.h"
+
+/* A square of the board in one byte, A1 = 0 to H8 = 63. Converts to its
+   index so it can look up attack tables and positions directly. */
+class Square {
+private:
+  uint8_t index;
+
+public:
+  /* -------------------- Constructors -------------------- */
+  /* No square */
+  constexpr Square() : index(64) {}
+
+  /* The square with index 0 to 63 */
+  constexpr explicit Square(int index) : index(static_cast<uint8_t>(index)) {}
+
+  /* The square at rank (0 = rank 1) and file (0 = file A) */
+  constexpr Square(int rank, int file) : index(static_cast<uint8_t>(make_square(rank, file))) {}
+
+  /* Parse a square such as E4 or e4. Return no square if text does not name one. */
+  static constexpr Square parse(const char text[]) {
+    if ((text == nullptr) || (text[0] == '\0') || (text[1] == '\0') || (text[2] != '\0'))
+      return Square();
+
+    int file = (text[0] >= 'a') ? text[0] - 'a' : text[0] - 'A';
+    int rank = text[1] - '1';
+
+    if ((file < 0) || (file > 7) || (rank < 0) || (rank > 7))
+      return Square();
+    return Square(rank, file);
+  }
+
+  /* -------------------- Helpers -------------------- */
+  /* Return the rank (0 = rank 1) */
+  constexpr int rank() const { return index >> 3; }
+
+  /* Return the file (0 = file A) */
+  constexpr int file() const { return index & 7; }
+
+  /* Return true if this is a square of the board */
+  constexpr bool valid() const { return index < 64; }
+
+  constexpr operator int() const { return index; }
+
+  /* Print the square as a file letter and rank digit, e.g. E4 */
+  friend std::ostream& operator<<(std::ostream &os, Square square) {
+    if (!square.valid())
+      return os << "-";
+    return os << static_cast<char>('A' + square.file()) << static_cast<char>('1' + square.rank());
+  }
+};
+
+static_assert(sizeof(Square) == 1, "Square must fit in a byte");
+static_assert(Square::parse("E4") == 28 && Square::parse("h8") == 63 && !Square::parse("H9").valid(), "Square::parse");
+
+#endif
@@ -0,0 +1,110 @@
+#include"ThreadPool.h"
+
+using namespace std;
+
+
+/* The pool whose worker is running on this thread, if any, and the worker's index in it */
+static thread_local const ThreadPool* current_pool = NULL;
+static thread_local int current_worker = -1;
+
+
+/* -------------------- ThreadPool -------------------- */
+/* -------------------- Constructor -------------------- */
+ThreadPool::ThreadPool(int thread_count) : queued(0), pending(0), next_worker(0), stopping(false) {
+  if (thread_count < 1)
+    thread_count = 1;
+
+  for (int i = 0; i < thread_count; i++)
+    workers.emplace_back(new Worker);
+
+  for (int i = 0; i < thread_count; i++)
+    threads.emplace_back(&ThreadPool::run, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    lock_guard<mutex> guard(sleep_lock);
+    stopping = true;
+  }
+  wake.notify_all();
+
+  for (thread &t : threads)
+    t.join();
+}
+
+/* -------------------- Tasks -------------------- */
+void ThreadPool::submit(Task task) {
+  // a task of another pool has no queue of its own here
+  int worker = (current_pool == this) ? current_worker : -1;
+
+  if (worker < 0)
+    worker = next_worker++ % workers.size();
+
+  pending++;
+  {
+    lock_guard<mutex> guard(workers[worker]->lock);
+    workers[worker]->tasks.push_back(move(task));
+  }
+  {
+    lock_guard<mutex> guard(sleep_lock);
+    queued++;
+  }
+  wake.notify_one();
+}
+
+void ThreadPool::wait() {
+  unique_lock<mutex> guard(sleep_lock);
+  done.wait(guard, [this] { return pending == 0; });
+}
+
+bool ThreadPool::pop(int worker, Task &task) {
+  lock_guard<mutex> guard(workers[worker]->lock);
+
+  if (workers[worker]->tasks.empty())
+    return false;
+
+  task = move(workers[worker]->tasks.back());
+  workers[worker]->tasks.pop_back();
+  return true;
+}
+
+bool ThreadPool::steal(int worker, Task &task) {
+  int count = static_cast<int>(workers.size());
+
+  for (int i = 1; i < count; i++) {
+    Worker &victim = *workers[(worker + i) % count];
+    lock_guard<mutex> guard(victim.lock);
+
+    if (!victim.tasks.empty()) {
+      task = move(victim.tasks.front());
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::run(int worker) {
+  current_pool = this;
+  current_worker = worker;
+
+  while (true) {
+    Task task;
+
+    if (pop(worker, task) || steal(worker, task)) {
+      queued--;
+      task(worker);
+
+      if (--pending == 0) {
+        lock_guard<mutex> guard(sleep_lock);
+        done.notify_all();
+      }
+      continue;
+    }
+
+    unique_lock<mutex> guard(sleep_lock);
+    wake.wait(guard, [this] { return stopping || (queued > 0); });
+    if (stopping && (queued == 0))
+      return;
+  }
+}
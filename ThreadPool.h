@@ -0,0 +1,64 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include<atomic>
+#include<condition_variable>
+#include<deque>
+#include<functional>
+#include<memory>
+#include<mutex>
+#include<thread>
+#include<vector>
+
+/* A fixed set of worker threads with one task queue each. A worker takes
+   tasks from the back of its own queue and, when that is empty, steals
+   from the front of the others. */
+class ThreadPool {
+public:
+  /* A task is given the index of the worker running it */
+  typedef std::function<void(int)> Task;
+
+private:
+  struct Worker {
+    std::mutex lock;
+    std::deque<Task> tasks;
+  };
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<std::thread> threads;
+  std::atomic<int> queued;
+  std::atomic<int> pending;
+  std::atomic<unsigned> next_worker;
+  std::mutex sleep_lock;
+  std::condition_variable wake;
+  std::condition_variable done;
+  bool stopping;
+
+  /* Take a task from the back of worker's own queue */
+  bool pop(int worker, Task &task);
+
+  /* Take a task from the front of another worker's queue */
+  bool steal(int worker, Task &task);
+
+  /* Run tasks on worker until the pool is destroyed */
+  void run(int worker);
+
+public:
+  /* -------------------- Constructors -------------------- */
+  explicit ThreadPool(int thread_count);
+  ~ThreadPool();
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /* -------------------- Tasks -------------------- */
+  /* Queue a task. Tasks queued from a worker go to that worker's own queue. */
+  void submit(Task task);
+
+  /* Block until every queued task has finished */
+  void wait();
+
+  /* Return the number of worker threads */
+  int size() const { return static_cast<int>(threads.size()); }
+};
+
+#endif
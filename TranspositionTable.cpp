@@ -0,0 +1,142 @@
+#include<algorithm>
+
+using namespace std;
+
+#include"TranspositionTable.h"
+
+
+/* Entries pack into 64 bits as:
+   bits 0-15 move, bits 16-31 score, bits 32-39 depth, bits 40-41 bound, bits 42-47 generation.
+   Every stored entry has a bound, so empty slots read as zero. */
+static inline uint64_t pack(Move move, int score, int depth, int bound, int generation) {
+  return static_cast<uint64_t>(move)
+       | (static_cast<uint64_t>(static_cast<uint16_t>(score)) << 16)
+       | (static_cast<uint64_t>(depth & 0xFF) << 32)
+       | (static_cast<uint64_t>(bound) << 40)
+       | (static_cast<uint64_t>(generation & 0x3F) << 42);
+}
+
+static inline int data_depth(uint64_t data) {
+  return (data >> 32) & 0xFF;
+}
+
+static inline int data_generation(uint64_t data) {
+  return (data >> 42) & 0x3F;
+}
+
+
+/* -------------------- TranspositionTable -------------------- */
+/* -------------------- Constructor -------------------- */
+TranspositionTable::TranspositionTable(int megabytes) : mask(0), generation(0), hits(0), misses(0), collisions(0) {
+  uint64_t count = 1;
+
+  while (count * 2 * sizeof(Bucket) <= (static_cast<uint64_t>(megabytes) << 20))
+    count *= 2;
+
+  buckets.reset(new Bucket[count]());
+  mask = count - 1;
+}
+
+void TranspositionTable::clear() {
+  for (uint64_t i = 0; i <= mask; i++) {
+    for (Slot &slot : buckets[i].slots) {
+      slot.check.store(0, memory_order_relaxed);
+      slot.data.store(0, memory_order_relaxed);
+    }
+  }
+
+  generation = 0;
+  hits = 0;
+  misses = 0;
+  collisions = 0;
+}
+
+void TranspositionTable::new_search() {
+  generation = (generation + 1) & 0x3F;
+}
+
+/* -------------------- Lookup -------------------- */
+bool TranspositionTable::probe(Key key, TTEntry &entry) const {
+  const Bucket &bucket = buckets[key & mask];
+
+  for (const Slot &slot : bucket.slots) {
+    uint64_t data = slot.data.load(memory_order_relaxed);
+    uint64_t check = slot.check.load(memory_order_relaxed);
+
+    if ((data == 0) || ((check ^ data) != key))
+      continue;
+
+    entry.move = static_cast<Move>(data & 0xFFFF);
+    entry.score = static_cast<int16_t>((data >> 16) & 0xFFFF);
+    entry.depth = data_depth(data);
+    entry.bound = (data >> 40) & 3;
+    return true;
+  }
+  return false;
+}
+
+bool TranspositionTable::store(Key key, Move move, int score, int depth, int bound) {
+  Bucket &bucket = buckets[key & mask];
+  Slot *replace = &bucket.slots[0];
+  int replace_value = 1 << 30;
+  bool same_key = false;
+
+  for (Slot &slot : bucket.slots) {
+    uint64_t data = slot.data.load(memory_order_relaxed);
+    uint64_t check = slot.check.load(memory_order_relaxed);
+
+    if ((data == 0) || ((check ^ data) == key)) {
+      // keep the best move of an earlier visit if this one found none
+      if ((data != 0) && (move == NO_MOVE))
+        move = static_cast<Move>(data & 0xFFFF);
+      replace = &slot;
+      same_key = true;
+      break;
+    }
+
+    // prefer to replace shallow entries and those left by earlier searches
+    int age = (generation - data_generation(data)) & 0x3F;
+    int value = data_depth(data) - 8 * age;
+
+    if (value < replace_value) {
+      replace = &slot;
+      replace_value = value;
+    }
+  }
+
+  uint64_t data = pack(move, score, max(depth, 0), bound, generation);
+
+  replace->data.store(data, memory_order_relaxed);
+  replace->check.store(key ^ data, memory_order_relaxed);
+  return !same_key;
+}
+
+/* -------------------- Statistics -------------------- */
+void TranspositionTable::add_stats(uint64_t thread_hits, uint64_t thread_misses, uint64_t thread_collisions) {
+  hits.fetch_add(thread_hits, memory_order_relaxed);
+  misses.fetch_add(thread_misses, memory_order_relaxed);
+  collisions.fetch_add(thread_collisions, memory_order_relaxed);
+}
+
+TTStats TranspositionTable::stats() const {
+  TTStats result;
+  uint64_t sampled = min<uint64_t>(mask + 1, 250);
+  uint64_t used = 0;
+
+  result.hits = hits.load(memory_order_relaxed);
+  result.misses = misses.load(memory_order_relaxed);
+  result.collisions = collisions.load(memory_order_relaxed);
+
+  // the first buckets are as good a sample as any
+  for (uint64_t i = 0; i < sampled; i++) {
+    for (const Slot &slot : buckets[i].slots) {
+      uint64_t data = slot.data.load(memory_order_relaxed);
+
+      if ((data != 0) && (data_generation(data) == generation))
+        used++;
+    }
+  }
+
+  result.fill = static_cast<int>(used * 1000 / (sampled * BUCKET_SIZE));
+  return result;
+}
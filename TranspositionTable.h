@@ -0,0 +1,88 @@
+#ifndef TRANSPOSITION_TABLE_H
+#define TRANSPOSITION_TABLE_H
+
+#include<atomic>
+#include<cstdint>
+#include<memory>
+
+#include"Move.h"
+#include"Zobrist.h"
+
+/* How a stored score relates to the true score of a position */
+enum Bound { BOUND_NONE = 0, BOUND_UPPER = 1, BOUND_LOWER = 2, BOUND_EXACT = 3 };
+
+/* A search result for one position, as read back from the table */
+struct TTEntry {
+  Move move;
+  int score;
+  int depth;
+  int bound;
+};
+
+/* Table usage, for tuning its size */
+struct TTStats {
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t collisions;
+  /* Entries written by the current search, per thousand */
+  int fill;
+};
+
+/* Fixed-size cache of search results shared by every search thread without
+   locks. Positions map to a bucket of four entries; each entry is stored as
+   (key ^ data, data) so a torn write from a racing thread fails verification
+   instead of being trusted. */
+class TranspositionTable {
+private:
+  struct Slot {
+    std::atomic<uint64_t> check;
+    std::atomic<uint64_t> data;
+  };
+
+  static const int BUCKET_SIZE = 4;
+
+  /* The slots a key can occupy, filling one cache line */
+  struct alignas(64) Bucket {
+    Slot slots[BUCKET_SIZE];
+  };
+
+  std::unique_ptr<Bucket[]> buckets;
+  uint64_t mask;
+  /* Age of the current search, so stale entries are replaced first */
+  uint8_t generation;
+
+  std::atomic<uint64_t> hits;
+  std::atomic<uint64_t> misses;
+  std::atomic<uint64_t> collisions;
+
+public:
+  /* -------------------- Constructors -------------------- */
+  /* Use about megabytes of memory, rounded down to a power of two buckets */
+  explicit TranspositionTable(int megabytes);
+
+  /* Discard every entry and reset the counters */
+  void clear();
+
+  /* Age the entries of earlier searches. Call before each new search. */
+  void new_search();
+
+  /* -------------------- Lookup -------------------- */
+  /* Return true and fill entry if key is stored. Not counted in the statistics. */
+  bool probe(Key key, TTEntry &entry) const;
+
+  /* Store a result for key, replacing the least useful entry of its bucket.
+     Return true if that entry held a different position. */
+  bool store(Key key, Move move, int score, int depth, int bound);
+
+  /* -------------------- Statistics -------------------- */
+  /* Add the probe results of one search thread, counted locally to keep the counters off the hot path */
+  void add_stats(uint64_t thread_hits, uint64_t thread_misses, uint64_t thread_collisions);
+
+  /* Return the counters and an estimate of the fill rate */
+  TTStats stats() const;
+
+  /* Return the size of the table in bytes */
+  uint64_t size_bytes() const { return (mask + 1) * sizeof(Bucket); }
+};
+
+#endif
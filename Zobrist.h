@@ -0,0 +1,48 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include<cstdint>
+
+/* A 64-bit position signature */
+typedef uint64_t Key;
+
+/* Random keys combined by XOR into a position's Zobrist key, built at
+   compile time so every build and every thread agrees on them */
+struct ZobristKeys {
+  Key pieces[16][64];
+  Key side;
+  Key castling[16];
+  Key en_passant[8];
+};
+
+/* Advance a xorshift64* generator and return its next output */
+constexpr Key next_random(Key &state) {
+  state ^= state >> 12;
+  state ^= state << 25;
+  state ^= state >> 27;
+  return state * 2685821657736338717ULL;
+}
+
+constexpr ZobristKeys make_zobrist_keys() {
+  ZobristKeys keys{};
+  Key state = 1070372;
+
+  for (int piece = 0; piece < 16; piece++) {
+    for (int square = 0; square < 64; square++)
+      keys.pieces[piece][square] = next_random(state);
+  }
+  keys.side = next_random(state);
+
+  // no castling rights contribute nothing
+  for (int rights = 1; rights < 16; rights++)
+    keys.castling[rights] = next_random(state);
+
+  for (int file = 0; file < 8; file++)
+    keys.en_passant[file] = next_random(state);
+
+  return keys;
+}
+
+inline constexpr ZobristKeys zobrist = make_zobrist_keys();
+
+#endif